@@ -0,0 +1,154 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include <map>
+#include <cmath>
+#include <algorithm>
+
+/* Adaptive timestep control for the implicit schemes, by step doubling:
+   each step is taken once with dt and again as two steps of dt / 2, and
+   for a scheme of order p the difference between the two answers,
+   divided by 2^p - 1, estimates the error in the more accurate one
+   (which is the one kept). Steps whose error is above tolerance are
+   thrown away and retried with a smaller dt; when the error is well
+   below tolerance dt is allowed to grow.
+
+   The matrix depends on dt, so to avoid factorising it again at every
+   step dt is restricted to a ladder dt_min * 2^k, k = 0 .. max_level,
+   and one factorised matrix is kept for each rung that has been used
+   (plus one for dt_min / 2, needed for the half steps on the bottom
+   rung). Time is counted in whole units of dt_min ("ticks").
+
+   The steps don't stop for output: step() goes on as far as the error
+   allows, and interpolate() gives the solution at any tick within the
+   last step, from its start, middle (the first half step, which comes
+   for free) and end. That is quadratic, so as accurate as the steps
+   themselves for the first and second order schemes.
+
+   The Scheme supplies the physics (see ThetaScheme in diffusion1d.h):
+
+       typedef ... Solver;
+       int order() const;
+       Solver factorise(double dt) const;
+       void step(Solver &solver, double dt, const vector<double> &u, vector<double> &u_next) const;
+
+   where step() must leave u untouched.
+*/
+template <class Scheme>
+class AdaptiveStepper
+{
+    public:
+        AdaptiveStepper(const Scheme &scheme,
+                        int n,                  // number of points
+                        double dt_min,          // bottom rung of the ladder
+                        int max_level,          // largest step is dt_min * 2^max_level
+                        double tol)             // error allowed per step, relative to max |u|
+            : scheme_(scheme), n_(n), dt_min_(dt_min), max_level_(max_level), tol_(tol),
+              level_(0), ticks_(0), start_(0), accepted_(0), rejected_(0), forced_(0),
+              full(n), half(n), twice(n), previous(n), middle(n)
+        {
+        }
+
+        /* Take one step of u (retrying with shorter ones until the error
+           is within tolerance). Returns false if a matrix could not be
+           factorised.
+        */
+        bool step(vector<double> &u)
+        {
+            for (;;)
+            {
+                int level = level_;
+                double dt = dt_min_ * (1LL << level);
+                Solver *whole = solver(level), *halves = solver(level - 1);
+                if (!whole || !halves) return false;
+
+                scheme_.step(*whole, dt, u, full);
+                scheme_.step(*halves, 0.5 * dt, u, half);
+                scheme_.step(*halves, 0.5 * dt, half, twice);
+
+                // scaled error estimate, <= 1 means within tolerance
+                double diff = 0.0, size = 0.0;
+                for (int i = 0; i < n_; ++i)
+                {
+                    diff = std::max(diff, std::fabs(twice(i) - full(i)));
+                    size = std::max(size, std::fabs(twice(i)));
+                }
+                double err = diff / ((1 << scheme_.order()) - 1) / (tol_ * std::max(size, 1e-300));
+
+                if (err > 1.0 && level > 0)
+                {
+                    // drop as many rungs as the error says are needed
+                    ++rejected_;
+                    double shrink = std::pow(err, 1.0 / (scheme_.order() + 1));
+                    level_ = std::max(0, level - std::max(1, int(std::ceil(std::log2(shrink / 0.9)))));
+                    continue;
+                }
+                if (err > 1.0) ++forced_;
+
+                // keep the start and middle of the step for interpolate()
+                previous.swap(u);
+                u.swap(twice);
+                middle.swap(half);
+                start_ = ticks_;
+                ticks_ += (1LL << level);
+                ++accepted_;
+
+                // climb as many rungs as the error allows, up to two (a factor of 4) at a time
+                double grow = 0.9 * std::pow(std::max(err, 1e-10), -1.0 / (scheme_.order() + 1));
+                if (grow >= 2.0) level_ = std::min(max_level_, level_ + std::min(2, int(std::log2(grow))));
+
+                return true;
+            }
+        }
+
+        /* The solution at tick t, which must be within the last step, given
+           u as step() left it; by quadratic interpolation through the
+           start, middle and end of the step.
+        */
+        void interpolate(long long t, const vector<double> &u, vector<double> &out) const
+        {
+            double s = double(t - start_) / (ticks_ - start_);
+            double w0 = 2 * (s - 0.5) * (s - 1), w1 = -4 * s * (s - 1), w2 = 2 * s * (s - 0.5);
+
+            for (int i = 0; i < n_; ++i) out(i) = w0 * previous(i) + w1 * middle(i) + w2 * u(i);
+        }
+
+        long long ticks() const { return ticks_; }
+        double time() const { return ticks_ * dt_min_; }
+        double dt() const { return dt_min_ * (1LL << level_); }
+
+        // statistics for the run so far
+        int accepted() const { return accepted_; }
+        int rejected() const { return rejected_; }
+        int forced() const { return forced_; }          // accepted on the bottom rung despite the error
+        int factorisations() const { return int(solvers.size()); }
+
+    private:
+        typedef typename Scheme::Solver Solver;
+
+        Scheme scheme_;
+        int n_;
+        double dt_min_;
+        int max_level_;
+        double tol_;
+
+        int level_;
+        long long ticks_, start_;       // the end and start of the last step
+        int accepted_, rejected_, forced_;
+
+        vector<double> full, half, twice, previous, middle;
+
+        // one factorised matrix per rung of the ladder used so far
+        std::map<int, Solver> solvers;
+
+        Solver *solver(int level)
+        {
+            typename std::map<int, Solver>::iterator it = solvers.find(level);
+            if (it == solvers.end())
+                it = solvers.insert(std::make_pair(level, scheme_.factorise(std::ldexp(dt_min_, level)))).first;
+
+            return it->second.ok() ? &it->second : 0;
+        }
+};
+
+#endif
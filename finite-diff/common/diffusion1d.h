@@ -0,0 +1,128 @@
+#ifndef DIFFUSION1D_H
+#define DIFFUSION1D_H
+
+#include <type_traits>
+
+#include "maths.h"
+#include "stencil1d.h"
+
+/* The theta scheme for the 1D diffusion equation,
+
+       u' - theta alpha d2 u' = u + (1 - theta) alpha d2 u
+
+   (d2 the second difference, alpha = D dt / dx^2), which is FTCS for
+   theta = 0, Crank-Nicolson for theta = 1/2 and backward Euler for
+   theta = 1. The explicit part is the same ftcsRange kernel as the FTCS
+   solver, with the boundary conditions applied as the kernel reaches
+   the ends of the grid. For the implicit part the conditions go into the
+   first and last rows of the matrix (see stencil1d.h), so no extra pass
+   over the grid is needed before or after the solve. For periodic
+   boundaries the matrix becomes cyclic and is solved over the interior
+   points only, with the ghost points copied in afterwards.
+
+   This has the interface AdaptiveStepper expects, and step() can also
+   be given any other solver built from matrix() (e.g. the parallel one).
+*/
+template <class Lo, class Hi>
+class ThetaScheme
+{
+    public:
+        static_assert(Lo::periodic == Hi::periodic, "periodic boundaries must be used at both ends");
+
+        static const bool periodic = Lo::periodic;
+        typedef typename std::conditional<periodic, CyclicTridiagonalSolver, TridiagonalSolver>::type Solver;
+
+        ThetaScheme(int Nx, double D, double dx, double theta, const Lo &lo, const Hi &hi)
+            : Nx(Nx), D(D), dx(dx), theta(theta), lo(lo), hi(hi)
+        {
+        }
+
+        // order of accuracy in time
+        int order() const { return theta == 0.5 ? 2 : 1; }
+
+        /* The matrix for a step of dt, with the boundary rows (not for
+           periodic boundaries, see factorise()).
+        */
+        void matrix(double dt, vector<double> &a, vector<double> &b, vector<double> &c) const
+        {
+            double f = theta * D * dt / (dx * dx);
+
+            for (int i = 0; i < Nx; ++i)
+            {
+                a(i) = -f;
+                b(i) = (1 + 2*f);
+                c(i) = -f;
+            }
+
+            a(0) = 0.0;
+            b(0) = 1.0;
+            c(0) = -lo.p;
+            a(Nx - 1) = -hi.p;
+            b(Nx - 1) = 1.0;
+            c(Nx - 1) = 0.0;
+        }
+
+        // the decomposed matrix for a step of dt
+        Solver factorise(double dt) const
+        {
+            return build(dt, std::integral_constant<bool, Lo::periodic>());
+        }
+
+        template <class S>
+        void step(S &solver, double dt, const vector<double> &u, vector<double> &u_next) const
+        {
+            const double *c = &u(0);
+            double *r = &u_next(0);
+            double alpha = D * dt / (dx * dx);
+
+            // the explicit part, i.e. the right hand side
+            if (theta < 1.0) ftcsInterior(c, r, Nx, (1 - theta) * alpha, lo, hi);
+            else std::copy(c + 1, c + Nx - 1, r + 1);
+
+            // and the implicit part, solved in place
+            if (theta == 0.0) fillGhosts(r, Nx, lo, hi);
+            else if (Lo::periodic)
+            {
+                solver.solve(r + 1, r + 1);
+                fillGhosts(r, Nx, lo, hi);
+            }
+            else
+            {
+                r[0] = lo.q;
+                r[Nx - 1] = hi.q;
+                solver.solve(r, r);
+            }
+        }
+
+    private:
+        int Nx;
+        double D, dx, theta;
+        Lo lo;
+        Hi hi;
+
+        TridiagonalSolver build(double dt, std::false_type) const
+        {
+            vector<double> a(Nx), b(Nx), c(Nx);
+            matrix(dt, a, b, c);
+            return TridiagonalSolver(a, b, c, Nx);
+        }
+
+        // the interior points only, wrapping round at the ends
+        CyclicTridiagonalSolver build(double dt, std::true_type) const
+        {
+            int n = Nx - 2;
+            double f = theta * D * dt / (dx * dx);
+            vector<double> a(n), b(n), c(n);
+
+            for (int i = 0; i < n; ++i)
+            {
+                a(i) = -f;
+                b(i) = (1 + 2*f);
+                c(i) = -f;
+            }
+
+            return CyclicTridiagonalSolver(a, b, c, -f, -f, n);
+        }
+};
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef FIELD_H
+#define FIELD_H
+
+#include <memory>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Split n slabs as evenly as possible between the threads of the
+   current parallel region, giving this thread slabs lo .. hi - 1.
+   Everything which loops over slabs uses this, so a given slab is
+   always handled by the same thread.
+*/
+inline void slabRange(int n, int &lo, int &hi)
+{
+#ifdef _OPENMP
+    int thread = omp_get_thread_num(), threads = omp_get_num_threads();
+#else
+    int thread = 0, threads = 1;
+#endif
+    lo = int((long long) n * thread / threads);
+    hi = int((long long) n * (thread + 1) / threads);
+}
+
+/* A scalar field on an nx x ny x nz grid of cells, padded with one layer
+   of halo (ghost) cells on every face so that the stencil never needs
+   special cases at the edges. For a 2D field (nz = 1) there is no halo
+   in z. The x index runs fastest, and indices go from -1 to n in each
+   padded direction, so f(-1, j, k) is the ghost cell left of f(0, j, k).
+
+   The grid is divided into slabs along its outermost direction (z in
+   3D, y in 2D) for threading. The storage is deliberately left
+   uninitialised by the allocation and then zeroed in parallel using the
+   same slabs as the stencil loops: on a NUMA machine each page then
+   lives on the node of the thread which will work on it ("first touch").
+*/
+class Field
+{
+    public:
+        Field(int nx, int ny, int nz) :
+            nx_(nx), ny_(ny), nz_(nz), hz_(nz > 1 ? 1 : 0),
+            sy_(nx + 2), sz_((nx + 2) * (ny + 2)),
+            size_(std::size_t(nx + 2) * (ny + 2) * (nz + 2 * hz_)),
+            data_(new double[size_])
+        {
+            #pragma omp parallel
+            {
+                int lo, hi;
+                slabRange(slabs(), lo, hi);
+
+                // the halo slabs at either end go with the first / last slab
+                std::ptrdiff_t first = (lo == 0) ? 0 : slabStart(lo);
+                std::ptrdiff_t last = (hi == slabs()) ? std::ptrdiff_t(size_) : slabStart(hi);
+
+                std::fill(data_.get() + first, data_.get() + last, 0.0);
+            }
+        }
+
+        int nx() const { return nx_; }
+        int ny() const { return ny_; }
+        int nz() const { return nz_; }
+        int dims() const { return nz_ > 1 ? 3 : 2; }
+
+        // distance in memory between neighbouring cells in y / z
+        std::ptrdiff_t strideY() const { return sy_; }
+        std::ptrdiff_t strideZ() const { return sz_; }
+
+        // number of slabs (planes in 3D, rows in 2D), and where slab s
+        // (including its x / y halo) starts in memory
+        int slabs() const { return hz_ ? nz_ : ny_; }
+        std::ptrdiff_t slabStart(int s) const { return hz_ ? index(-1, -1, s) : index(-1, s, 0); }
+
+        std::ptrdiff_t index(int i, int j, int k) const
+        {
+            return (k + hz_) * sz_ + (j + 1) * sy_ + (i + 1);
+        }
+
+        double &operator()(int i, int j, int k = 0) { return data_[index(i, j, k)]; }
+        double operator()(int i, int j, int k = 0) const { return data_[index(i, j, k)]; }
+
+        double *data() { return data_.get(); }
+        const double *data() const { return data_.get(); }
+
+        void swap(Field &other) { data_.swap(other.data_); }
+
+    private:
+        int nx_, ny_, nz_, hz_;
+        std::ptrdiff_t sy_, sz_;
+        std::size_t size_;
+        std::unique_ptr<double[]> data_;
+};
+
+
+/* Call op(j, k) for every row of the field, with the rows shared
+   between threads by slab (as for the constructor's first touch).
+   Must be called outside any parallel region.
+*/
+template <class RowOp>
+inline void forEachRow(const Field &u, RowOp op)
+{
+    #pragma omp parallel
+    {
+        int lo, hi;
+        slabRange(u.slabs(), lo, hi);
+
+        if (u.dims() == 3)
+        {
+            for (int k = lo; k < hi; ++k)
+                for (int j = 0; j < u.ny(); ++j) op(j, k);
+        }
+        else
+        {
+            for (int j = lo; j < hi; ++j) op(j, 0);
+        }
+    }
+}
+
+// copy the interior (not the halo) of one field into another of the same size
+inline void copyInterior(const Field &from, Field &to)
+{
+    forEachRow(from, [&](int j, int k)
+    {
+        std::ptrdiff_t n = from.index(0, j, k);
+        std::copy(from.data() + n, from.data() + n + from.nx(), to.data() + n);
+    });
+}
+
+
+enum BoundaryType { DIRICHLET, NEUMANN, PERIODIC };
+
+/* Condition on one face of the grid. For DIRICHLET, value is the
+   concentration held at the wall; NEUMANN means no flux through the
+   wall; PERIODIC must be set on both faces of the same direction.
+*/
+struct Boundary
+{
+    BoundaryType type;
+    double value;
+};
+
+// faces in the order x-, x+, y-, y+, z-, z+
+enum Face { X_LO, X_HI, Y_LO, Y_HI, Z_LO, Z_HI };
+
+
+/* Value for a ghost cell, given the cell just inside the wall ("edge")
+   and the cell on the opposite side of the grid ("opposite"). The wall
+   sits half way between the ghost and edge cells, so DIRICHLET sets
+   the average of the two to the wall value.
+*/
+inline double ghostValue(const Boundary &bc, double edge, double opposite)
+{
+    switch (bc.type)
+    {
+        case DIRICHLET: return 2 * bc.value - edge;
+        case NEUMANN:   return edge;
+        case PERIODIC:  return opposite;
+    }
+    return edge;
+}
+
+
+/* Fill the halo cells of every face from the boundary conditions. Only
+   the faces are filled (not edges or corners), which is all the 5 / 7
+   point stencil reads.
+*/
+inline void applyBoundaries(Field &u, const Boundary bc[6])
+{
+    const int nx = u.nx(), ny = u.ny(), nz = u.nz();
+    const bool threeD = (u.dims() == 3);
+
+    #pragma omp parallel
+    {
+        int lo, hi;
+        slabRange(u.slabs(), lo, hi);
+
+        for (int s = lo; s < hi; ++s)
+        {
+            // x faces (and y faces in 3D) lie within the slab
+            int k = threeD ? s : 0;
+            int j_lo = threeD ? 0 : s, j_hi = threeD ? ny : s + 1;
+
+            for (int j = j_lo; j < j_hi; ++j)
+            {
+                u(-1, j, k) = ghostValue(bc[X_LO], u(0, j, k), u(nx - 1, j, k));
+                u(nx, j, k) = ghostValue(bc[X_HI], u(nx - 1, j, k), u(0, j, k));
+            }
+
+            if (threeD)
+            {
+                for (int i = 0; i < nx; ++i)
+                {
+                    u(i, -1, k) = ghostValue(bc[Y_LO], u(i, 0, k), u(i, ny - 1, k));
+                    u(i, ny, k) = ghostValue(bc[Y_HI], u(i, ny - 1, k), u(i, 0, k));
+                }
+            }
+        }
+
+        // the remaining faces are whole slabs / rows of halo, share them out
+        if (threeD)
+        {
+            for (int j = lo * ny / nz; j < hi * ny / nz; ++j)
+            {
+                for (int i = 0; i < nx; ++i)
+                {
+                    u(i, j, -1) = ghostValue(bc[Z_LO], u(i, j, 0), u(i, j, nz - 1));
+                    u(i, j, nz) = ghostValue(bc[Z_HI], u(i, j, nz - 1), u(i, j, 0));
+                }
+            }
+        }
+        else
+        {
+            for (int i = lo * nx / ny; i < hi * nx / ny; ++i)
+            {
+                u(i, -1) = ghostValue(bc[Y_LO], u(i, 0), u(i, ny - 1));
+                u(i, ny) = ghostValue(bc[Y_HI], u(i, ny - 1), u(i, 0));
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,446 @@
+#ifndef FIELDIO_H
+#define FIELDIO_H
+
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <deque>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+#ifdef FIELDIO_ZLIB
+#include <zlib.h>
+#endif
+
+/* Snapshot output for the finite difference solvers.
+
+   File layout (native byte order, which the header records):
+
+       "FIELDIO1", uint32 header bytes, header text
+       then one record per snapshot:
+           "SNAP", uint32 compressed, int64 step, float64 time,
+           uint64 raw bytes, uint64 stored bytes, data
+
+   The header text is a list of "key: value" lines, always including
+   nx, ny, nz, type (float64) and endian, plus whatever the driver adds
+   (D, dx, dt, ...), so a file can be read back without knowing which
+   program wrote it. The data of a snapshot is nx * ny * nz doubles with
+   x running fastest, either raw or (if built with FIELDIO_ZLIB and asked
+   for) deflated.
+*/
+
+/* Shape of the field, plus any other parameters worth recording */
+class FieldInfo
+{
+    public:
+        FieldInfo(int nx = 1, int ny = 1, int nz = 1) : nx(nx), ny(ny), nz(nz) {}
+
+        template <class T>
+        void set(const std::string &key, const T &value)
+        {
+            std::ostringstream s;
+            s.precision(17);
+            s << value;
+            keys.push_back(key);
+            values.push_back(s.str());
+        }
+
+        // value of an extra parameter, or "" if it was never set
+        std::string get(const std::string &key) const
+        {
+            for (std::size_t i = 0; i < keys.size(); ++i)
+                if (keys[i] == key) return values[i];
+            return "";
+        }
+
+        std::size_t points() const { return std::size_t(nx) * ny * nz; }
+
+        std::string text() const
+        {
+            std::ostringstream s;
+            s << "nx: " << nx << "\nny: " << ny << "\nnz: " << nz << "\n";
+            s << "type: float64\nendian: " << (littleEndian() ? "little" : "big") << "\n";
+            for (std::size_t i = 0; i < keys.size(); ++i) s << keys[i] << ": " << values[i] << "\n";
+            return s.str();
+        }
+
+        // inverse of text(), false if the shape is missing
+        bool parse(const std::string &text)
+        {
+            std::istringstream s(text);
+            std::string line;
+            bool shape[3] = { false, false, false };
+
+            keys.clear();
+            values.clear();
+            while (std::getline(s, line))
+            {
+                std::size_t colon = line.find(": ");
+                if (colon == std::string::npos) continue;
+
+                std::string key = line.substr(0, colon), value = line.substr(colon + 2);
+                if (key == "nx") { nx = std::atoi(value.c_str()); shape[0] = true; }
+                else if (key == "ny") { ny = std::atoi(value.c_str()); shape[1] = true; }
+                else if (key == "nz") { nz = std::atoi(value.c_str()); shape[2] = true; }
+                else if (key != "type" && key != "endian")
+                {
+                    keys.push_back(key);
+                    values.push_back(value);
+                }
+            }
+            return shape[0] && shape[1] && shape[2];
+        }
+
+        int nx, ny, nz;
+        std::vector<std::string> keys, values;
+
+        static bool littleEndian()
+        {
+            uint16_t one = 1;
+            return *reinterpret_cast<unsigned char *>(&one) == 1;
+        }
+};
+
+
+/* Writes snapshots from a background thread, so the solver only ever
+   waits for a copy of its field, never for the disk.
+
+   write() copies the field into one of a fixed number of buffers and
+   hands it to the writer thread, which compresses it (if asked) and
+   writes it through a large stdio buffer. write() only blocks if every
+   buffer is still queued, i.e. if the disk really can't keep up with
+   the solver, which bounds the memory used.
+*/
+class FieldWriter
+{
+    public:
+        FieldWriter(const std::string &filename, const FieldInfo &info, bool compress = false, int buffers = 4)
+            : info_(info), compress_(compress), closing(false), pool(buffers)
+        {
+#ifndef FIELDIO_ZLIB
+            compress_ = false;
+#endif
+            file = std::fopen(filename.c_str(), "wb");
+            if (!file) return;
+            std::setvbuf(file, 0, _IOFBF, 1 << 20);
+
+            std::string header = info.text();
+            uint32_t bytes = uint32_t(header.size());
+            std::fwrite("FIELDIO1", 1, 8, file);
+            std::fwrite(&bytes, sizeof(bytes), 1, file);
+            std::fwrite(header.data(), 1, header.size(), file);
+
+            for (int i = 0; i < buffers; ++i)
+            {
+                pool[i].data.resize(info.points());
+                free_.push_back(i);
+            }
+
+            worker = std::thread(&FieldWriter::run, this);
+        }
+
+        ~FieldWriter() { close(); }
+
+        bool good() const { return file != 0; }
+
+        // queue a snapshot stored contiguously, x fastest
+        void write(long long step, double time, const double *data)
+        {
+            write(step, time, data, info_.nx, std::ptrdiff_t(info_.nx) * info_.ny);
+        }
+
+        /* queue a snapshot whose rows are spread out in memory, e.g. a
+           field padded with halo cells: point (i, j, k) is at
+           origin[i + j*sy + k*sz]
+        */
+        void write(long long step, double time, const double *origin, std::ptrdiff_t sy, std::ptrdiff_t sz)
+        {
+            if (!file) return;
+
+            int b = takeBuffer();
+            Snapshot &s = pool[b];
+            s.step = step;
+            s.time = time;
+
+            double *out = &s.data[0];
+            for (int k = 0; k < info_.nz; ++k)
+                for (int j = 0; j < info_.ny; ++j, out += info_.nx)
+                    std::memcpy(out, origin + j*sy + k*sz, info_.nx * sizeof(double));
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queued.push_back(b);
+            }
+            work.notify_one();
+        }
+
+        // write out everything queued and close the file
+        void close()
+        {
+            if (!file) return;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closing = true;
+            }
+            work.notify_one();
+            worker.join();
+
+            std::fclose(file);
+            file = 0;
+        }
+
+    private:
+        struct Snapshot
+        {
+            long long step;
+            double time;
+            std::vector<double> data;
+        };
+
+        FieldInfo info_;
+        bool compress_;
+        std::FILE *file;
+
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable work, done;
+        bool closing;
+
+        std::vector<Snapshot> pool;
+        std::vector<int> free_;
+        std::deque<int> queued;
+
+        int takeBuffer()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this] { return !free_.empty(); });
+
+            int b = free_.back();
+            free_.pop_back();
+            return b;
+        }
+
+        void run()
+        {
+            std::vector<unsigned char> packed;
+
+            for (;;)
+            {
+                int b;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    work.wait(lock, [this] { return closing || !queued.empty(); });
+                    if (queued.empty()) return;
+
+                    b = queued.front();
+                    queued.pop_front();
+                }
+
+                record(pool[b], packed);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    free_.push_back(b);
+                }
+                done.notify_one();
+            }
+        }
+
+        void record(const Snapshot &s, std::vector<unsigned char> &packed)
+        {
+            uint64_t raw = s.data.size() * sizeof(double), stored = raw;
+            const void *bytes = &s.data[0];
+            uint32_t compressed = 0;
+
+#ifdef FIELDIO_ZLIB
+            if (compress_)
+            {
+                uLongf size = compressBound(uLong(raw));
+                packed.resize(size);
+                if (compress2(&packed[0], &size, reinterpret_cast<const Bytef *>(bytes), uLong(raw), Z_BEST_SPEED) == Z_OK)
+                {
+                    bytes = &packed[0];
+                    stored = size;
+                    compressed = 1;
+                }
+            }
+#else
+            (void) packed;
+#endif
+
+            int64_t step = s.step;
+            std::fwrite("SNAP", 1, 4, file);
+            std::fwrite(&compressed, sizeof(compressed), 1, file);
+            std::fwrite(&step, sizeof(step), 1, file);
+            std::fwrite(&s.time, sizeof(s.time), 1, file);
+            std::fwrite(&raw, sizeof(raw), 1, file);
+            std::fwrite(&stored, sizeof(stored), 1, file);
+            std::fwrite(bytes, 1, stored, file);
+        }
+};
+
+
+/* Reads back the snapshots of a FieldWriter file in order */
+class FieldReader
+{
+    public:
+        explicit FieldReader(const std::string &filename) : file(std::fopen(filename.c_str(), "rb")), size(0)
+        {
+            if (!file) return;
+
+            // the size of the file bounds every length read from it
+            std::fseek(file, 0, SEEK_END);
+            size = std::ftell(file);
+            std::rewind(file);
+
+            char magic[8];
+            uint32_t bytes;
+            if (std::fread(magic, 1, 8, file) != 8 || std::memcmp(magic, "FIELDIO1", 8) != 0
+                || std::fread(&bytes, sizeof(bytes), 1, file) != 1
+                || bytes > (1 << 20) || bytes > size - 12)
+            {
+                fail();
+                return;
+            }
+
+            std::string header(bytes, '\0');
+            if (std::fread(&header[0], 1, bytes, file) != bytes || !info_.parse(header)) fail();
+        }
+
+        ~FieldReader() { if (file) std::fclose(file); }
+
+        bool good() const { return file != 0; }
+        const FieldInfo &info() const { return info_; }
+
+        /* The next snapshot, or false at the end of the file. A damaged
+           record (lengths that don't fit the field or the file, or data
+           that won't inflate) also gives false, and makes good() false.
+        */
+        bool next(long long &step, double &time, std::vector<double> &data)
+        {
+            if (!file) return false;
+
+            char magic[4];
+            if (std::fread(magic, 1, 4, file) != 4) return false;
+
+            uint32_t compressed;
+            int64_t s;
+            uint64_t raw, stored;
+            if (std::memcmp(magic, "SNAP", 4) != 0
+                || std::fread(&compressed, sizeof(compressed), 1, file) != 1
+                || std::fread(&s, sizeof(s), 1, file) != 1
+                || std::fread(&time, sizeof(time), 1, file) != 1
+                || std::fread(&raw, sizeof(raw), 1, file) != 1
+                || std::fread(&stored, sizeof(stored), 1, file) != 1
+                || raw != info_.points() * sizeof(double)
+                || (!compressed && stored != raw)
+                || stored > uint64_t(size - std::ftell(file)))
+                return damaged();
+
+            step = s;
+            data.resize(info_.points());
+
+            if (!compressed)
+                return std::fread(&data[0], 1, stored, file) == stored || damaged();
+
+#ifdef FIELDIO_ZLIB
+            packed.resize(stored);
+            if (std::fread(&packed[0], 1, stored, file) != stored) return damaged();
+
+            uLongf inflated = uLongf(raw);
+            if (uncompress(reinterpret_cast<Bytef *>(&data[0]), &inflated, &packed[0], uLong(stored)) != Z_OK
+                || inflated != raw)
+                return damaged();
+            return true;
+#else
+            return damaged();
+#endif
+        }
+
+    private:
+        std::FILE *file;
+        long size;
+        FieldInfo info_;
+        std::vector<unsigned char> packed;
+
+        void fail()
+        {
+            std::fclose(file);
+            file = 0;
+        }
+
+        bool damaged()
+        {
+            fail();
+            return false;
+        }
+};
+
+
+/* Convert a FieldWriter file to the text format the gnuplot scripts
+   read. 1D fields give "x t phi" lines with a blank line after each
+   snapshot (t being the step); 2D fields give one "x y phi" block per
+   snapshot, separated by two blank lines so each is a gnuplot index,
+   and 3D fields are shown by their middle z plane. Only sensible for
+   small grids.
+
+   The data rows are the same as the solvers used to write directly,
+   but the header comments are not: they give the shape (nx, ny, nz)
+   and then one "# key: value" line per parameter in the file, at full
+   precision, instead of the old two summary lines. Returns false if
+   either file can't be opened or a damaged snapshot is found (the ones
+   before it are still converted).
+*/
+inline bool exportGnuplot(const std::string &in, const std::string &out)
+{
+    FieldReader reader(in);
+    if (!reader.good()) return false;
+
+    std::FILE *text = std::fopen(out.c_str(), "w");
+    if (!text) return false;
+    std::setvbuf(text, 0, _IOFBF, 1 << 20);
+
+    const FieldInfo &info = reader.info();
+    const bool oneD = (info.ny == 1 && info.nz == 1);
+
+    std::fprintf(text, "# nx: %d, ny: %d, nz: %d\n", info.nx, info.ny, info.nz);
+    for (std::size_t i = 0; i < info.keys.size(); ++i)
+        std::fprintf(text, "# %s: %s\n", info.keys[i].c_str(), info.values[i].c_str());
+    std::fprintf(text, oneD ? "# x \t t \t phi \n" : "# x \t y \t phi \n");
+
+    long long step;
+    double time;
+    std::vector<double> data;
+    const std::size_t plane = std::size_t(info.nz / 2) * info.nx * info.ny;
+
+    while (reader.next(step, time, data))
+    {
+        if (oneD)
+        {
+            for (int x = 0; x < info.nx; ++x) std::fprintf(text, "%d\t%lld\t%.6g\n", x, step, data[x]);
+        }
+        else
+        {
+            std::fprintf(text, "# t = %lld\n", step);
+            for (int x = 0; x < info.nx; ++x)
+            {
+                for (int y = 0; y < info.ny; ++y)
+                    std::fprintf(text, "%d\t%d\t%.6g\n", x, y, data[plane + std::size_t(y) * info.nx + x]);
+                std::fprintf(text, "\n");
+            }
+        }
+        std::fprintf(text, "\n");
+    }
+
+    std::fclose(text);
+    return reader.good();
+}
+
+#endif
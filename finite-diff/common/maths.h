@@ -0,0 +1,456 @@
+#ifndef MATHS_H
+#define MATHS_H
+
+#include <boost/numeric/ublas/vector.hpp>
+using boost::numeric::ublas::vector;
+#include <iostream>
+using std::cout;
+using std::endl;
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Method for solving a tridiagonal set of linear 
+   equations, as described in Numerical Recipes in C.
+*/    
+bool tridag(const vector<double> &a,    // lower diagonal values
+            const vector<double> &b,    // diagonal values
+            const vector<double> &c,    // upper diagonal values
+            const vector<double> &r,
+            vector<double> &u,
+            const int &n)               // for n x n matrix
+{
+    double beta;
+
+    vector<double> gamma(n);
+
+    // If this happens, the set of equations should be 
+    // rewritten with u_2 eliminated.
+    if (b(0) == 0.0)
+    {
+        cout << "b(0) == 0" << endl;
+        return false;
+    }
+
+    beta = b(0);
+    u(0) = r(0) / beta;
+
+
+    // Decomposition and forward substitution
+    for (int j = 1; j < n; ++j)
+    {
+        gamma(j) = c(j-1) / beta;
+        beta = b(j) - a(j) * gamma(j);
+        
+        if (beta == 0.0)
+        {
+            cout << "zero pivot! unable to continue" << endl;
+            return false;
+        }
+
+        u(j) = (r(j) - a(j)*u(j-1)) / beta;
+    }
+
+    // Backsubstitution
+    for (int j = (n - 2); j >= 0; --j) u(j) -= gamma(j+1) * u(j+1);
+
+    return true;
+}
+
+
+/* Tridiagonal solver for a matrix which is the same every time it is
+   used (e.g. at every timestep of the implicit scheme). The LU
+   decomposition from tridag() is done once, when the solver is built,
+   and stored as
+
+       inv_beta(j) = 1 / beta(j)
+       l(j)        = a(j) / beta(j)
+       gamma(j)    = c(j-1) / beta(j-1)
+
+   so each solve is just the forward and back substitution, with no
+   divisions and no memory allocated.
+*/
+class TridiagonalSolver
+{
+    public:
+        TridiagonalSolver(const vector<double> &a,    // lower diagonal values
+                          const vector<double> &b,    // diagonal values
+                          const vector<double> &c,    // upper diagonal values
+                          const int &n)               // for n x n matrix
+            : n_(n), ok_(true), inv_beta(n), l(n), gamma(n)
+        {
+            double beta = b(0);
+
+            // If this happens, the set of equations should be 
+            // rewritten with u_2 eliminated.
+            if (beta == 0.0)
+            {
+                cout << "b(0) == 0" << endl;
+                ok_ = false;
+                return;
+            }
+
+            inv_beta[0] = 1.0 / beta;
+            l[0] = 0.0;
+
+            for (int j = 1; j < n; ++j)
+            {
+                gamma[j] = c(j-1) / beta;
+                beta = b(j) - a(j) * gamma[j];
+
+                if (beta == 0.0)
+                {
+                    cout << "zero pivot! unable to continue" << endl;
+                    ok_ = false;
+                    return;
+                }
+
+                inv_beta[j] = 1.0 / beta;
+                l[j] = a(j) / beta;
+            }
+        }
+
+        // false if the decomposition failed (zero pivot)
+        bool ok() const { return ok_; }
+        int size() const { return n_; }
+
+        // solve for one right hand side (r and u may be the same array)
+        void solve(const double *r, double *u) const
+        {
+            u[0] = r[0] * inv_beta[0];
+            for (int j = 1; j < n_; ++j) u[j] = r[j] * inv_beta[j] - l[j] * u[j-1];
+
+            for (int j = (n_ - 2); j >= 0; --j) u[j] -= gamma[j+1] * u[j+1];
+        }
+
+        void solve(const vector<double> &r, vector<double> &u) const { solve(&r(0), &u(0)); }
+
+        /* Solve m independent systems which share this matrix, with
+           their right hand sides interleaved: element j of system s is
+           r[j*stride + s] (stride defaults to m). Every step of the
+           substitution is then the same operation on m consecutive
+           numbers, which vectorises. Giving a stride larger than m lets
+           several threads each take a range of systems from the same
+           arrays. r and u may be the same array.
+        */
+        void solveBatch(const double *r, double *u, int m, int stride = 0) const
+        {
+            if (stride == 0) stride = m;
+
+            for (int s = 0; s < m; ++s) u[s] = r[s] * inv_beta[0];
+
+            for (int j = 1; j < n_; ++j)
+            {
+                const double ib = inv_beta[j], lj = l[j];
+                const double *rj = r + j*stride;
+                const double *prev = u + (j-1)*stride;
+                double *uj = u + j*stride;
+
+                #pragma omp simd
+                for (int s = 0; s < m; ++s) uj[s] = rj[s] * ib - lj * prev[s];
+            }
+
+            for (int j = (n_ - 2); j >= 0; --j)
+            {
+                const double g = gamma[j+1];
+                const double *next = u + (j+1)*stride;
+                double *uj = u + j*stride;
+
+                #pragma omp simd
+                for (int s = 0; s < m; ++s) uj[s] -= g * next[s];
+            }
+        }
+
+    private:
+        int n_;
+        bool ok_;
+        std::vector<double> inv_beta, l, gamma;
+};
+
+
+/* Tridiagonal solver for a matrix with two extra corner elements, alpha
+   in the bottom left and beta in the top right, as comes from periodic
+   boundaries. As in cyclic() from Numerical Recipes, the matrix is
+   written as a tridiagonal matrix plus an outer product, and the
+   Sherman-Morrison formula corrects the tridiagonal solution. Both the
+   decomposition and the correction vector z only depend on the matrix,
+   so they are worked out once and each solve is one tridiagonal solve
+   plus one correction.
+*/
+class CyclicTridiagonalSolver
+{
+    public:
+        CyclicTridiagonalSolver(const vector<double> &a,    // lower diagonal values
+                                const vector<double> &b,    // diagonal values
+                                const vector<double> &c,    // upper diagonal values
+                                double alpha,               // bottom left corner
+                                double beta,                // top right corner
+                                const int &n)               // for n x n matrix, n > 2
+            : n_(n), beta_(beta), gamma_(-b(0)), denominator(1.0),
+              tri(a, modifiedDiagonal(b, alpha, beta, n), c, n), z(n)
+        {
+            if (!tri.ok()) return;
+
+            std::vector<double> e(n, 0.0);
+            e[0] = gamma_;
+            e[n - 1] = alpha;
+            tri.solve(&e[0], &z[0]);
+
+            denominator = 1.0 + z[0] + beta_ * z[n - 1] / gamma_;
+        }
+
+        bool ok() const { return tri.ok(); }
+        int size() const { return n_; }
+
+        // solve for one right hand side (r and u may be the same array)
+        void solve(const double *r, double *u) const
+        {
+            tri.solve(r, u);
+
+            double f = (u[0] + beta_ * u[n_ - 1] / gamma_) / denominator;
+            for (int j = 0; j < n_; ++j) u[j] -= f * z[j];
+        }
+
+        void solve(const vector<double> &r, vector<double> &u) const { solve(&r(0), &u(0)); }
+
+    private:
+        int n_;
+        double beta_, gamma_, denominator;
+        TridiagonalSolver tri;
+        std::vector<double> z;
+
+        // the diagonal of the tridiagonal part (gamma = -b(0), as NR suggests)
+        static vector<double> modifiedDiagonal(const vector<double> &b, double alpha, double beta, int n)
+        {
+            vector<double> bb(b);
+            bb(0) = b(0) + b(0);
+            bb(n - 1) = b(n - 1) + alpha * beta / b(0);
+            return bb;
+        }
+};
+
+
+/* Tridiagonal solver which shares each solve between threads, for
+   systems too big for one core (the Thomas algorithm above is
+   inherently sequential).
+
+   The rows are split into "parts" blocks separated by single rows
+   k_1 < k_2 < ... (the separators). Inside a block the equations only
+   involve the block itself plus the separators either side, so with
+   the separator values u_L, u_R unknown, every row i of the block is
+
+       u(i) = y(i) + v(i) u_L + w(i) u_R
+
+   where y solves the block's own system with the real right hand side,
+   and v, w are the responses to the couplings -a(first) and -c(last).
+   Substituting this into the equations at the separators leaves a
+   small tridiagonal system for the separator values alone.
+
+   As for TridiagonalSolver, everything which only depends on the matrix
+   (the block decompositions, v, w and the reduced system) is worked
+   out once when the solver is built, so each solve is: the blocks'
+   substitutions in parallel, a serial solve of size (parts - 1), then
+   the blocks' corrections in parallel. It uses about twice the flops
+   of the serial solve, so it only pays off for large n on several cores.
+*/
+class ParallelTridiagonalSolver
+{
+    public:
+        ParallelTridiagonalSolver(const vector<double> &a,    // lower diagonal values
+                                  const vector<double> &b,    // diagonal values
+                                  const vector<double> &c,    // upper diagonal values
+                                  const int &n,               // for n x n matrix
+                                  int parts = 0)              // default: one per thread
+            : n_(n), ok_(true), inv_beta(n), l(n), gamma(n), v(n), w(n)
+        {
+            if (parts <= 0) parts = maxThreads();
+            parts = std::max(1, std::min(parts, n / 2));     // blocks mustn't be empty
+
+            // block p covers rows first[p] .. last[p] - 1, and
+            // separator p (for p > 0) is row first[p] - 1
+            for (int p = 0; p < parts; ++p)
+            {
+                first.push_back(p == 0 ? 0 : int((long long) n * p / parts) + 1);
+                last.push_back(p == parts - 1 ? n : int((long long) n * (p + 1) / parts));
+            }
+
+            int failed = 0;
+
+            #pragma omp parallel for schedule(static) reduction(+:failed)
+            for (int p = 0; p < parts; ++p)
+            {
+                if (!factorBlock(a, b, c, p)) { ++failed; continue; }
+
+                int s = first[p], e = last[p];
+
+                // response to the left separator...
+                if (p > 0)
+                {
+                    for (int i = s; i < e; ++i) v[i] = 0.0;
+                    v[s] = -a(s);
+                    substituteBlock(&v[0], &v[0], p);
+                }
+
+                // ... and to the right one
+                if (p < parts - 1)
+                {
+                    for (int i = s; i < e; ++i) w[i] = 0.0;
+                    w[e - 1] = -c(e - 1);
+                    substituteBlock(&w[0], &w[0], p);
+                }
+            }
+
+            if (failed)
+            {
+                cout << "zero pivot! unable to continue" << endl;
+                ok_ = false;
+                return;
+            }
+
+            // reduced system for the separators (row k = first[p] - 1
+            // sits between blocks p - 1 and p)
+            int m = parts - 1;
+            vector<double> ra(std::max(m, 1)), rb(std::max(m, 1)), rc(std::max(m, 1));
+
+            for (int q = 0; q < m; ++q)
+            {
+                int k = first[q + 1] - 1;
+                sep_a.push_back(a(k));
+                sep_c.push_back(c(k));
+
+                ra(q) = a(k) * v[k - 1];
+                rb(q) = b(k) + a(k) * w[k - 1] + c(k) * v[k + 1];
+                rc(q) = c(k) * w[k + 1];
+            }
+
+            if (m > 0)
+            {
+                reduced.reset(new TridiagonalSolver(ra, rb, rc, m));
+                ok_ = reduced->ok();
+                separator_rhs.resize(m);
+            }
+        }
+
+        bool ok() const { return ok_; }
+        int size() const { return n_; }
+        int parts() const { return first.size(); }
+
+        // solve for one right hand side (r and u may be the same array)
+        void solve(const double *r, double *u)
+        {
+            const int parts = first.size();
+
+            // y for every block, stored straight into u
+            #pragma omp parallel for schedule(static)
+            for (int p = 0; p < parts; ++p) substituteBlock(r, u, p);
+
+            if (parts == 1) return;
+
+            // separator values
+            for (int q = 0; q < parts - 1; ++q)
+            {
+                int k = first[q + 1] - 1;
+                separator_rhs[q] = r[k] - sep_a[q] * u[k - 1] - sep_c[q] * u[k + 1];
+            }
+
+            reduced->solve(&separator_rhs[0], &separator_rhs[0]);
+
+            for (int q = 0; q < parts - 1; ++q) u[first[q + 1] - 1] = separator_rhs[q];
+
+            // and correct each block for its separators
+            #pragma omp parallel for schedule(static)
+            for (int p = 0; p < parts; ++p)
+            {
+                double uL = (p > 0) ? u[first[p] - 1] : 0.0;
+                double uR = (p < parts - 1) ? u[last[p]] : 0.0;
+
+                for (int i = first[p]; i < last[p]; ++i) u[i] += v[i] * uL + w[i] * uR;
+            }
+        }
+
+        void solve(const vector<double> &r, vector<double> &u) { solve(&r(0), &u(0)); }
+
+    private:
+        int n_;
+        bool ok_;
+
+        // per-block decompositions, stored as for TridiagonalSolver
+        std::vector<double> inv_beta, l, gamma;
+        // responses of each block to its left / right separators
+        std::vector<double> v, w;
+        // block boundaries
+        std::vector<int> first, last;
+        // separator couplings a(k), c(k), kept for the right hand side
+        std::vector<double> sep_a, sep_c;
+
+        std::unique_ptr<TridiagonalSolver> reduced;
+        std::vector<double> separator_rhs;
+
+        static int maxThreads()
+        {
+#ifdef _OPENMP
+            return omp_get_max_threads();
+#else
+            return 1;
+#endif
+        }
+
+        bool factorBlock(const vector<double> &a, const vector<double> &b,
+                         const vector<double> &c, int p)
+        {
+            int s = first[p], e = last[p];
+            double beta = b(s);
+            if (beta == 0.0) return false;
+
+            inv_beta[s] = 1.0 / beta;
+            l[s] = 0.0;
+
+            for (int j = s + 1; j < e; ++j)
+            {
+                gamma[j] = c(j-1) / beta;
+                beta = b(j) - a(j) * gamma[j];
+                if (beta == 0.0) return false;
+
+                inv_beta[j] = 1.0 / beta;
+                l[j] = a(j) / beta;
+            }
+            return true;
+        }
+
+        // forward / back substitution within block p only
+        void substituteBlock(const double *r, double *u, int p) const
+        {
+            int s = first[p], e = last[p];
+
+            u[s] = r[s] * inv_beta[s];
+            for (int j = s + 1; j < e; ++j) u[j] = r[j] * inv_beta[j] - l[j] * u[j-1];
+
+            for (int j = e - 2; j >= s; --j) u[j] -= gamma[j+1] * u[j+1];
+        }
+};
+
+
+/* Same interface as tridag(), but solved in parallel (see above). For
+   repeated solves with the same matrix build a ParallelTridiagonalSolver
+   once instead.
+*/
+bool tridagParallel(const vector<double> &a,    // lower diagonal values
+                    const vector<double> &b,    // diagonal values
+                    const vector<double> &c,    // upper diagonal values
+                    const vector<double> &r,
+                    vector<double> &u,
+                    const int &n,               // for n x n matrix
+                    int parts = 0)              // default: one per thread
+{
+    ParallelTridiagonalSolver solver(a, b, c, n, parts);
+    if (!solver.ok()) return false;
+
+    solver.solve(r, u);
+    return true;
+}
+
+#endif
@@ -0,0 +1,421 @@
+#ifndef MULTIGRID_H
+#define MULTIGRID_H
+
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+
+#include "field.h"
+
+/* Matrix-free operators on a Field with cells of width h, for the
+   interior cells only. The halo of u must already be filled (see
+   applyBoundaries()).
+
+       helmholtz:  out = sigma u - kappa lap(u)
+       laplacian:  out = lap(u)
+
+   with lap the 5 point (2D) or 7 point (3D) Laplacian. An implicit
+   diffusion step is sigma = 1, kappa = D dt, i.e. (I - D dt lap) u.
+*/
+inline void helmholtz(const Field &u, Field &out, double sigma, double kappa, double h)
+{
+    const int nx = u.nx();
+    const bool threeD = (u.dims() == 3);
+    const std::ptrdiff_t sy = u.strideY(), sz = threeD ? u.strideZ() : 0;
+    const double k = kappa / (h * h), centre = sigma + 2 * u.dims() * k;
+    const double dz = threeD ? 1.0 : 0.0;
+
+    forEachRow(u, [&](int j, int kk)
+    {
+        std::ptrdiff_t n = u.index(0, j, kk);
+        const double *c = u.data() + n;
+        double *o = out.data() + n;
+
+        #pragma omp simd
+        for (int i = 0; i < nx; ++i)
+            o[i] = centre * c[i] - k * (c[i + 1] + c[i - 1] + c[i + sy] + c[i - sy]
+                                        + dz * (c[i + sz] + c[i - sz]));
+    });
+}
+
+inline void laplacian(const Field &u, Field &out, double h)
+{
+    helmholtz(u, out, 0.0, -1.0, h);
+}
+
+
+/* Geometric multigrid for
+
+       sigma u - kappa lap(u) = f
+
+   on a cell centred grid, with the boundary conditions of each face as
+   for applyBoundaries(). sigma = 0, kappa = -1 is the Poisson equation
+   lap(u) = f.
+
+   The grid is coarsened by 2 in every direction (z only in 3D) while the
+   sizes stay even and at least 4, so sizes with a large power of two as
+   a factor work best. Each level re-discretises the operator with its
+   own h; the smoother is red-black Gauss-Seidel, the restriction
+   averages the 4 (8) fine cells under each coarse cell, and corrections
+   are interpolated back (bi/trilinearly) from the coarse grid, whose
+   halo holds the homogeneous versions of the boundary conditions. All
+   of these are threaded by slab, like the rest of the Field code.
+
+   solve() starts with one full multigrid (FMG) pass by default, then
+   runs V or W cycles until the residual has dropped by tol. With no
+   Dirichlet faces and sigma = 0 the problem only fixes u up to a
+   constant: f should then sum to zero, and u is kept at zero mean.
+*/
+class Multigrid
+{
+    public:
+        enum Cycle { V_CYCLE = 1, W_CYCLE = 2 };
+
+        Multigrid(int nx, int ny, int nz, double h, const Boundary bc[6],
+                  double sigma = 0.0, double kappa = -1.0)
+            : sigma(sigma), kappa(kappa), pre_sweeps(2), post_sweeps(2), coarse_tol(1e-3)
+        {
+            for (int f = 0; f < 6; ++f)
+            {
+                bc_[f] = bc[f];
+                hom[f] = bc[f];
+                hom[f].value = 0.0;
+            }
+
+            const bool threeD = (nz > 1);
+            levels.push_back(std::unique_ptr<Level>(new Level(nx, ny, nz, h, false)));
+
+            while (nx % 2 == 0 && ny % 2 == 0 && nx >= 4 && ny >= 4
+                   && (!threeD || (nz % 2 == 0 && nz >= 4)))
+            {
+                nx /= 2;
+                ny /= 2;
+                if (threeD) nz /= 2;
+                h *= 2;
+                levels.push_back(std::unique_ptr<Level>(new Level(nx, ny, nz, h, true)));
+            }
+
+            singular_ = true;
+            for (int f = 0; f < (threeD ? 6 : 4); ++f)
+                if (bc[f].type == DIRICHLET) singular_ = false;
+        }
+
+        // change the operator, e.g. for a new timestep
+        void setOperator(double s, double k) { sigma = s; kappa = k; }
+        void setSweeps(int pre, int post) { pre_sweeps = pre; post_sweeps = post; }
+
+        int levelCount() const { return int(levels.size()); }
+        bool singular() const { return singular_ && sigma == 0.0; }
+
+        /* Solve with u as the initial guess (its halo is ignored). Returns
+           the number of cycles used, or -1 if the residual had not
+           dropped by tol after max_cycles.
+        */
+        int solve(Field &u, const Field &f, double tol = 1e-8, int max_cycles = 50,
+                  Cycle cycle = V_CYCLE, bool fmg = true)
+        {
+            double target = tol * std::max(norm(f), 1e-300);
+
+            if (fmg) fullMultigrid(u, f);
+
+            for (int n = 0; n < max_cycles; ++n)
+            {
+                if (residualNorm(u, f) <= target) return n;
+
+                this->cycle(0, u, f, int(cycle));
+                if (singular()) removeMean(u);
+            }
+
+            return residualNorm(u, f) <= target ? max_cycles : -1;
+        }
+
+        // root mean square of f - A u over the interior
+        double residualNorm(Field &u, const Field &f)
+        {
+            residual(0, u, f, levels[0]->r);
+            return norm(levels[0]->r);
+        }
+
+    private:
+        struct Level
+        {
+            Level(int nx, int ny, int nz, double h, bool storage)
+                : h(h), r(nx, ny, nz),
+                  u(storage ? new Field(nx, ny, nz) : 0), f(storage ? new Field(nx, ny, nz) : 0)
+            {
+            }
+
+            double h;
+            Field r;
+            // the finest level uses the caller's u and f
+            std::unique_ptr<Field> u, f;
+        };
+
+        std::vector<std::unique_ptr<Level> > levels;
+        Boundary bc_[6], hom[6];
+        double sigma, kappa;
+        int pre_sweeps, post_sweeps;
+        double coarse_tol;
+        bool singular_;
+
+        const Boundary *bcFor(int l) const { return l == 0 ? bc_ : hom; }
+
+        // one red-black Gauss-Seidel sweep of each colour
+        void smooth(int l, Field &u, const Field &f, int sweeps)
+        {
+            const int nx = u.nx();
+            const bool threeD = (u.dims() == 3);
+            const std::ptrdiff_t sy = u.strideY(), sz = threeD ? u.strideZ() : 0;
+            const double h = levels[l]->h, k = kappa / (h * h);
+            const double inv_centre = 1.0 / (sigma + 2 * u.dims() * k);
+            const double dz = threeD ? 1.0 : 0.0;
+
+            for (int s = 0; s < sweeps; ++s)
+            {
+                for (int colour = 0; colour < 2; ++colour)
+                {
+                    applyBoundaries(u, bcFor(l));
+
+                    forEachRow(u, [&](int j, int kk)
+                    {
+                        std::ptrdiff_t n = u.index(0, j, kk);
+                        double *c = u.data() + n;
+                        const double *rhs = f.data() + n;
+
+                        for (int i = (j + kk + colour) & 1; i < nx; i += 2)
+                            c[i] = (rhs[i] + k * (c[i + 1] + c[i - 1] + c[i + sy] + c[i - sy]
+                                                  + dz * (c[i + sz] + c[i - sz]))) * inv_centre;
+                    });
+                }
+            }
+        }
+
+        // r = f - A u
+        void residual(int l, Field &u, const Field &f, Field &r)
+        {
+            applyBoundaries(u, bcFor(l));
+            helmholtz(u, r, sigma, kappa, levels[l]->h);
+
+            const int nx = u.nx();
+            forEachRow(u, [&](int j, int kk)
+            {
+                std::ptrdiff_t n = u.index(0, j, kk);
+                const double *rhs = f.data() + n;
+                double *o = r.data() + n;
+
+                #pragma omp simd
+                for (int i = 0; i < nx; ++i) o[i] = rhs[i] - o[i];
+            });
+        }
+
+        // coarse = average of the fine cells under each coarse cell
+        static void restrictTo(const Field &fine, Field &coarse)
+        {
+            const int nx = coarse.nx();
+            const bool threeD = (coarse.dims() == 3);
+            const std::ptrdiff_t sy = fine.strideY(), sz = fine.strideZ();
+            const double w = threeD ? 0.125 : 0.25;
+
+            forEachRow(coarse, [&](int j, int k)
+            {
+                const double *a = fine.data() + fine.index(0, 2 * j, threeD ? 2 * k : 0);
+                double *o = coarse.data() + coarse.index(0, j, k);
+
+                for (int i = 0; i < nx; ++i)
+                {
+                    const double *c = a + 2 * i;
+                    double sum = c[0] + c[1] + c[sy] + c[sy + 1];
+                    if (threeD) sum += c[sz] + c[sz + 1] + c[sz + sy] + c[sz + sy + 1];
+                    o[i] = w * sum;
+                }
+            });
+        }
+
+        /* fine += interpolated coarse. Each fine cell lies in a quarter
+           (eighth) of a coarse cell, and takes 3/4 of that cell and 1/4
+           of the neighbour on its side, in each direction.
+        */
+        static void prolongAdd(const Field &coarse, Field &fine)
+        {
+            const int nx = fine.nx();
+            const bool threeD = (fine.dims() == 3);
+            const std::ptrdiff_t sy = coarse.strideY(), sz = coarse.strideZ();
+
+            forEachRow(fine, [&](int j, int k)
+            {
+                const int J = j / 2, K = threeD ? k / 2 : 0;
+                const std::ptrdiff_t dj = (j & 1) ? sy : -sy;
+                const std::ptrdiff_t dk = threeD ? ((k & 1) ? sz : -sz) : 0;
+                const double wk = threeD ? 0.75 : 1.0, wk1 = threeD ? 0.25 : 0.0;
+
+                const double *c = coarse.data() + coarse.index(0, J, K);
+                double *o = fine.data() + fine.index(0, j, k);
+
+                for (int i = 0; i < nx; ++i)
+                {
+                    const double *p = c + i / 2;
+                    const int di = (i & 1) ? 1 : -1;
+
+                    double row = 0.75 * (0.75 * p[0] + 0.25 * p[di]) + 0.25 * (0.75 * p[dj] + 0.25 * p[dj + di]);
+                    double next = threeD ? 0.75 * (0.75 * p[dk] + 0.25 * p[dk + di])
+                                         + 0.25 * (0.75 * p[dk + dj] + 0.25 * p[dk + dj + di]) : 0.0;
+                    o[i] += wk * row + wk1 * next;
+                }
+            });
+        }
+
+        /* The interpolation also reads the halo cells along the edges and
+           corners of the coarse grid, which applyBoundaries() leaves
+           alone; fill them by linear extrapolation from the faces.
+        */
+        static void fillHaloEdges(Field &u)
+        {
+            const int nx = u.nx(), ny = u.ny(), nz = u.nz();
+            const int ci[2] = { -1, nx }, cj[2] = { -1, ny }, ck[2] = { -1, nz };
+            const int ii[2] = { 0, nx - 1 }, jj[2] = { 0, ny - 1 }, kk[2] = { 0, nz - 1 };
+
+            if (u.dims() == 2)
+            {
+                for (int a = 0; a < 2; ++a)
+                    for (int b = 0; b < 2; ++b)
+                        u(ci[a], cj[b]) = u(ci[a], jj[b]) + u(ii[a], cj[b]) - u(ii[a], jj[b]);
+                return;
+            }
+
+            // edges along x, then y, then z (which includes the corners)
+            for (int a = 0; a < 2; ++a)
+                for (int b = 0; b < 2; ++b)
+                {
+                    for (int i = 0; i < nx; ++i)
+                        u(i, cj[a], ck[b]) = u(i, cj[a], kk[b]) + u(i, jj[a], ck[b]) - u(i, jj[a], kk[b]);
+                    for (int j = 0; j < ny; ++j)
+                        u(ci[a], j, ck[b]) = u(ci[a], j, kk[b]) + u(ii[a], j, ck[b]) - u(ii[a], j, kk[b]);
+                }
+
+            for (int a = 0; a < 2; ++a)
+                for (int b = 0; b < 2; ++b)
+                    for (int k = -1; k <= nz; ++k)
+                        u(ci[a], cj[b], k) = u(ci[a], jj[b], k) + u(ii[a], cj[b], k) - u(ii[a], jj[b], k);
+        }
+
+        static void zero(Field &u)
+        {
+            forEachRow(u, [&](int j, int k)
+            {
+                double *o = u.data() + u.index(0, j, k);
+                std::fill(o, o + u.nx(), 0.0);
+            });
+        }
+
+        // root mean square over the interior, summed slab by slab so the
+        // answer doesn't depend on the number of threads
+        static double norm(const Field &u)
+        {
+            std::vector<double> partial(u.dims() == 3 ? u.nz() : u.ny(), 0.0);
+
+            forEachRow(u, [&](int j, int k)
+            {
+                const double *c = u.data() + u.index(0, j, k);
+                double sum = 0.0;
+                for (int i = 0; i < u.nx(); ++i) sum += c[i] * c[i];
+                partial[u.dims() == 3 ? k : j] += sum;
+            });
+
+            double sum = 0.0;
+            for (std::size_t s = 0; s < partial.size(); ++s) sum += partial[s];
+            return std::sqrt(sum / (double(u.nx()) * u.ny() * u.nz()));
+        }
+
+        static void removeMean(Field &u)
+        {
+            double mean = 0.0;
+            for (int k = 0; k < u.nz(); ++k)
+                for (int j = 0; j < u.ny(); ++j)
+                    for (int i = 0; i < u.nx(); ++i) mean += u(i, j, k);
+            mean /= double(u.nx()) * u.ny() * u.nz();
+
+            forEachRow(u, [&](int j, int k)
+            {
+                double *o = u.data() + u.index(0, j, k);
+                for (int i = 0; i < u.nx(); ++i) o[i] -= mean;
+            });
+        }
+
+        // smooth the coarsest level until its residual has dropped by coarse_tol
+        void solveCoarsest(int l, Field &u, const Field &f)
+        {
+            // a singular problem only has a solution if f sums to zero,
+            // which restriction only keeps up to rounding
+            if (singular() && l > 0) removeMean(*levels[l]->f);
+
+            double target = coarse_tol * norm(f);
+            for (int s = 0; s < 10000; s += 10)
+            {
+                smooth(l, u, f, 10);
+                if (singular()) removeMean(u);
+
+                residual(l, u, f, levels[l]->r);
+                if (norm(levels[l]->r) <= target) break;
+            }
+        }
+
+        // gamma = 1 for a V cycle, 2 for a W cycle
+        void cycle(int l, Field &u, const Field &f, int gamma)
+        {
+            if (l == int(levels.size()) - 1)
+            {
+                solveCoarsest(l, u, f);
+                return;
+            }
+
+            smooth(l, u, f, pre_sweeps);
+
+            Level &coarse = *levels[l + 1];
+            residual(l, u, f, levels[l]->r);
+            restrictTo(levels[l]->r, *coarse.f);
+            zero(*coarse.u);
+
+            for (int g = 0; g < gamma; ++g) cycle(l + 1, *coarse.u, *coarse.f, gamma);
+
+            applyBoundaries(*coarse.u, hom);
+            fillHaloEdges(*coarse.u);
+            prolongAdd(*coarse.u, u);
+
+            smooth(l, u, f, post_sweeps);
+        }
+
+        /* Full multigrid: solve on the coarsest grid first, then use each
+           solution (interpolated) as the starting point of a V cycle on
+           the next grid up. Only the right hand side is taken from the
+           finest grid, so u's initial value is ignored.
+        */
+        void fullMultigrid(Field &u, const Field &f)
+        {
+            const int last = int(levels.size()) - 1;
+
+            if (last > 0) restrictTo(f, *levels[1]->f);
+            for (int l = 2; l <= last; ++l) restrictTo(*levels[l - 1]->f, *levels[l]->f);
+
+            for (int l = last; l >= 0; --l)
+            {
+                Field &ul = (l == 0) ? u : *levels[l]->u;
+                const Field &fl = (l == 0) ? f : *levels[l]->f;
+
+                zero(ul);
+                if (l < last)
+                {
+                    applyBoundaries(*levels[l + 1]->u, hom);
+                    fillHaloEdges(*levels[l + 1]->u);
+                    prolongAdd(*levels[l + 1]->u, ul);
+                }
+
+                if (l == last) solveCoarsest(l, ul, fl);
+                else cycle(l, ul, fl, 1);
+            }
+
+            if (singular()) removeMean(u);
+        }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef STENCIL1D_H
+#define STENCIL1D_H
+
+/* Boundary conditions for the 1D diffusion solvers, as policy types so
+   that the kernels are compiled for the conditions actually in use.
+
+   The grid has Nx points, of which 0 and Nx - 1 are ghost points just
+   outside the domain. Every condition apart from periodic fixes the
+   ghost from the point just inside ("edge") as
+
+       ghost = p * edge + q
+
+   which the explicit kernels apply as they reach the ends of the grid,
+   and the implicit ones put into the first / last rows of the matrix
+   (-p next to the diagonal, q in the right hand side). A periodic
+   ghost is a copy of the edge point at the other end ("opposite").
+*/
+
+// fixed value
+struct Dirichlet
+{
+    static const bool periodic = false;
+    double p, q;
+
+    explicit Dirichlet(double value = 0.0) : p(0.0), q(value) {}
+    double ghost(double, double) const { return q; }
+};
+
+// fixed gradient (ghost - edge) / dx = gradient; the default is no flux,
+// in which case the total amount of material is conserved exactly
+struct Neumann
+{
+    static const bool periodic = false;
+    double p, q;
+
+    explicit Neumann(double gradient = 0.0, double dx = 1.0) : p(1.0), q(gradient * dx) {}
+    double ghost(double edge, double) const { return edge + q; }
+};
+
+// mixed condition a u + b du/dn = g, with u taken at the ghost point and
+// du/dn = (ghost - edge) / dx; b = 0 gives Dirichlet, a = 0 Neumann
+struct Robin
+{
+    static const bool periodic = false;
+    double p, q;
+
+    Robin(double a, double b, double g, double dx) : p((b / dx) / (a + b / dx)), q(g / (a + b / dx)) {}
+    double ghost(double edge, double) const { return p * edge + q; }
+};
+
+// must be used at both ends
+struct Periodic
+{
+    static const bool periodic = true;
+    double p, q;                        // unused
+
+    Periodic() : p(0.0), q(0.0) {}
+    double ghost(double, double opposite) const { return opposite; }
+};
+
+
+// set both ghost points of u (Nx points) from the boundary conditions
+template <class Lo, class Hi>
+inline void fillGhosts(double *u, int Nx, const Lo &lo, const Hi &hi)
+{
+    u[0] = lo.ghost(u[1], u[Nx - 2]);
+    u[Nx - 1] = hi.ghost(u[Nx - 2], u[1]);
+}
+
+
+/* One FTCS step for the points i = lo .. hi - 1 (which must all have
+   both neighbours available in u). The arrays must not overlap, which
+   together with the simd pragma lets the loop be vectorised.
+*/
+inline void ftcsRange(const double * __restrict__ u,
+                      double * __restrict__ u_next,
+                      int lo, int hi, double factor)
+{
+    #pragma omp simd
+    for (int i = lo; i < hi; ++i)
+        u_next[i] = u[i] + factor * (u[i + 1] + u[i - 1] - 2 * u[i]);
+}
+
+
+/* ftcsRange over the whole interior 1 .. Nx - 2, taking the ghost values
+   from the boundary conditions as it goes rather than from u, so the
+   ghost points of u don't need to be filled first.
+*/
+template <class Lo, class Hi>
+inline void ftcsInterior(const double * __restrict__ u,
+                         double * __restrict__ u_next,
+                         int Nx, double factor, const Lo &lo, const Hi &hi)
+{
+    double g_lo = lo.ghost(u[1], u[Nx - 2]);
+    double g_hi = hi.ghost(u[Nx - 2], u[1]);
+
+    u_next[1] = u[1] + factor * (u[2] + g_lo - 2 * u[1]);
+    ftcsRange(u, u_next, 2, Nx - 2, factor);
+    u_next[Nx - 2] = u[Nx - 2] + factor * (g_hi + u[Nx - 3] - 2 * u[Nx - 2]);
+}
+
+#endif
@@ -0,0 +1,8 @@
+set title "ADI diffusion in 2D (final snapshot)"
+set xlabel "position (x)"
+set ylabel "position (y)"
+set cblabel "concentration (phi)"
+set pm3d map
+set nokey
+stats "output.dat" using 3 nooutput
+splot 	"output.dat" index (STATS_blocks - 1) using 1:2:3 with pm3d
@@ -0,0 +1,190 @@
+#include <boost/numeric/ublas/vector.hpp>
+using boost::numeric::ublas::vector;
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+using std::cout;
+using std::endl;
+
+#include "maths.h"
+#include "fieldio.h"
+
+
+/* Share n items (here, independent tridiagonal systems) between the
+   threads of the current parallel region.
+*/
+inline void threadRange(int n, int &lo, int &hi)
+{
+#ifdef _OPENMP
+    int thread = omp_get_thread_num(), threads = omp_get_num_threads();
+#else
+    int thread = 0, threads = 1;
+#endif
+    lo = int((long long) n * thread / threads);
+    hi = int((long long) n * (thread + 1) / threads);
+}
+
+
+/* Matrix for (1 - h d^2/dx^2) along one grid line of n points, with
+   the Dirichlet boundary values held in the first and last rows.
+*/
+TridiagonalSolver lineSolver(int n, double h)
+{
+    vector<double> a(n), b(n), c(n);
+
+    for (int i = 0; i < n; ++i)
+    {
+        a(i) = -h;
+        b(i) = (1 + 2*h);
+        c(i) = -h;
+    }
+
+    a(0) = c(0) = 0.0;
+    b(0) = 1.0;
+    a(n - 1) = c(n - 1) = 0.0;
+    b(n - 1) = 1.0;
+
+    return TridiagonalSolver(a, b, c, n);
+}
+
+
+int main (int, char **)
+{
+
+    int N_t = 200;                  // number of timesteps
+    int N_x = 200, N_y = 200;       // number of spacial points
+    double dt = 0.5, dx = 0.01;     // timestep / spacial resolution
+    double D = 0.00005;             // diffusion const
+
+    int time_resolution = 20;       // don't need to plot every time point
+    int tile = 32;                  // block size for the transposing loops
+
+    // snapshots go to data/output.fld (deflated if compress is set), and
+    // for grids up to text_limit points also to data/output.dat for gnuplot
+    bool compress = false;
+    int text_limit = 100000;
+
+    // save calculating this at every step (each half step
+    // is worth half of alpha in each direction)
+    double alpha = D * dt / (dx * dx);
+    double h = 0.5 * alpha;
+
+    cout << "ADI (Peaceman-Rachford) method applied to the 2D diffusion equation" << endl;
+    cout << "alpha = " << alpha << endl;
+
+    /* Each step is split into two halves, each implicit in one direction
+       and explicit in the other:
+
+           (1 - h dxx) u*    = (1 + h dyy) u
+           (1 - h dyy) u_new = (1 + h dxx) u*
+
+       so every half step is a set of independent tridiagonal solves,
+       one per grid line, which all share the same matrix. The lines
+       are solved together by TridiagonalSolver::solveBatch(), which
+       needs the lines interleaved in memory: for the x solves that means
+       x-major storage ("A": point (i, j) at [i*N_y + j]), and for the
+       y solves y-major storage ("B": [j*N_x + i]). Each right hand side
+       pass reads in one layout and writes in the other, so the
+       transposes come for free. u is kept in layout B between steps.
+
+       NOTE: here we are using Dirichlet BCs, u = 0 on all four walls.
+    */
+    TridiagonalSolver solver_x = lineSolver(N_x, h);
+    TridiagonalSolver solver_y = lineSolver(N_y, h);
+    if (!solver_x.ok() || !solver_y.ok()) return 1;
+
+    std::vector<double> u(N_x * N_y), r(N_x * N_y), u_star(N_x * N_y);
+
+    // initialise system with a few drops of material
+    u[int(0.5 * N_y) * N_x + int(0.4 * N_x)] = 1000.0;
+    u[int(0.3 * N_y) * N_x + int(0.6 * N_x)] = 1000.0;
+    u[int(0.9 * N_y) * N_x + int(0.1 * N_x)] = 1000.0;
+
+
+    // write results to file as we go, in the background
+    FieldInfo info(N_x, N_y);
+    info.set("D", D);
+    info.set("N_t", N_t);
+    info.set("dx", dx);
+    info.set("dt", dt);
+    FieldWriter output("data/output.fld", info, compress);
+    if (!output.good()) return 1;
+
+
+    // main experiment
+    for (int t = 0; t < N_t; ++t)
+    {
+        // write a snapshot (every so often)
+        if (t % time_resolution == 0)
+        {
+            double mass = 0.0;
+            for (int i = 0; i < N_x * N_y; ++i) mass += u[i];
+            cout << "mass at timestep " << t << " is: " << mass << endl;
+
+            output.write(t, t * dt, &u[0]);
+        }
+
+        if (t == N_t - 1) break;
+
+        // first half: right hand side (1 + h dyy) u, from B into A
+        #pragma omp parallel for collapse(2) schedule(static)
+        for (int ib = 0; ib < N_x; ib += tile)
+        {
+            for (int jb = 0; jb < N_y; jb += tile)
+            {
+                for (int i = ib; i < std::min(N_x, ib + tile); ++i)
+                {
+                    for (int j = jb; j < std::min(N_y, jb + tile); ++j)
+                    {
+                        const double *uc = &u[j * N_x + i];
+                        bool wall = (i == 0 || i == N_x - 1 || j == 0 || j == N_y - 1);
+
+                        r[i * N_y + j] = wall ? 0.0 : uc[0] + h * (uc[N_x] - 2 * uc[0] + uc[-N_x]);
+                    }
+                }
+            }
+        }
+
+        // implicit in x, one system for each j
+        #pragma omp parallel
+        {
+            int lo, hi;
+            threadRange(N_y, lo, hi);
+            if (hi > lo) solver_x.solveBatch(&r[lo], &u_star[lo], hi - lo, N_y);
+        }
+
+        // second half: right hand side (1 + h dxx) u*, from A into B
+        #pragma omp parallel for collapse(2) schedule(static)
+        for (int jb = 0; jb < N_y; jb += tile)
+        {
+            for (int ib = 0; ib < N_x; ib += tile)
+            {
+                for (int j = jb; j < std::min(N_y, jb + tile); ++j)
+                {
+                    for (int i = ib; i < std::min(N_x, ib + tile); ++i)
+                    {
+                        const double *uc = &u_star[i * N_y + j];
+                        bool wall = (i == 0 || i == N_x - 1 || j == 0 || j == N_y - 1);
+
+                        r[j * N_x + i] = wall ? 0.0 : uc[0] + h * (uc[N_y] - 2 * uc[0] + uc[-N_y]);
+                    }
+                }
+            }
+        }
+
+        // implicit in y, one system for each i
+        #pragma omp parallel
+        {
+            int lo, hi;
+            threadRange(N_x, lo, hi);
+            if (hi > lo) solver_y.solveBatch(&r[lo], &u[lo], hi - lo, N_x);
+        }
+    }
+
+    // finish writing to file
+    output.close();
+    if (N_x * N_y <= text_limit) exportGnuplot("data/output.fld", "data/output.dat");
+
+    return 0;
+}
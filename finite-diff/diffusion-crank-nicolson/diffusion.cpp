@@ -5,12 +5,15 @@ using boost::numeric::ublas::vector;
 #include <boost/numeric/ublas/io.hpp>
 
 #include <iostream>
-#include <fstream>
 using std::cout;
 using std::endl;
-using std::ofstream;
 
-#include "utilities/maths.h"
+#include "diffusion1d.h"
+#include "adaptive.h"
+#include "fieldio.h"
+#include <memory>
+#include <cmath>
+
 
 int main (int, char **)
 {
@@ -20,12 +23,37 @@ int main (int, char **)
     double dt = 0.5, dx = 0.01;     // timestep / spacial resolution
     double D = 0.00005;             // diffusion const
 
+    // above this many points the linear solve is shared between
+    // threads, and checked against the serial solver on the first step
+    int parallel_threshold = 100000;
+    bool verify_parallel = true;
+
+    // with adaptive stepping dt above is only the output spacing: steps
+    // are chosen between dt / dt_divisions and dt * 2^max_level to keep
+    // the estimated error per step below tolerance (relative to the peak)
+    bool adaptive = true;
+    int dt_divisions = 8;
+    int max_level = 10;
+    double tolerance = 1e-3;
+
+    // snapshots go to data/output.fld (deflated if compress is set), and
+    // for grids up to text_limit points also to data/output.dat for gnuplot
+    bool compress = false;
+    int text_limit = 100000;
+
     // save calculating this at every step
     double alpha = D * dt / (dx * dx);
 
-    cout << "implicit finite difference method applied to the diffusion equation" << endl;
+    cout << "Crank-Nicolson method applied to the diffusion equation" << endl;
     cout << "alpha = " << alpha << endl;
 
+    // NOTE: here we are using Dirichlet BCs, i.e:
+    // u(0, t) = u(N_x - 1, t) = 0 for all t
+    // (any of the conditions in stencil1d.h can be used at either end,
+    // and Crank-Nicolson is the theta = 1/2 scheme)
+    typedef ThetaScheme<Dirichlet, Dirichlet> Scheme;
+    Scheme scheme(N_x, D, dx, 0.5, Dirichlet(), Dirichlet());
+
 
     // these store the components of the tridiagonal matrix 
     // used to solve the system of linear equations
@@ -35,54 +63,98 @@ int main (int, char **)
     u(int(0.4 * N_x)) = 100.0;
     u(int(0.6 * N_x)) = 100.0;
 
-    for (int i = 0; i < N_x; ++i)
+    // for fixed steps the matrix is the same at every timestep,
+    // so only decompose it once
+    Scheme::Solver solver = scheme.factorise(dt);
+    if (!solver.ok()) return 1;
+
+    std::unique_ptr<ParallelTridiagonalSolver> parallel_solver;
+    if (!adaptive && !Scheme::periodic && N_x >= parallel_threshold)
     {
-        a(i) = -alpha;
-        b(i) = (1 + 2*alpha);
-        c(i) = -alpha;
+        scheme.matrix(dt, a, b, c);
+        parallel_solver.reset(new ParallelTridiagonalSolver(a, b, c, N_x));
+        if (!parallel_solver->ok()) return 1;
+        cout << "using parallel solver with " << parallel_solver->parts() << " parts" << endl;
     }
 
+    AdaptiveStepper<Scheme> stepper(scheme, N_x, dt / dt_divisions, max_level, tolerance);
+
+
+    // write results to file as we go, in the background
+    FieldInfo info(N_x);
+    info.set("D", D);
+    info.set("N_t", N_t);
+    info.set("dx", dx);
+    info.set("dt", dt);
+    FieldWriter output("data/output.fld", info, compress);
+    if (!output.good()) return 1;
 
-    // write results to file, starting with a header for GNUPLOT
-    ofstream dataFile;
-    dataFile.open("data/output.dat", std::ios::trunc);
-    dataFile << "# D: " << D << ", N_x: " << N_x << ", N_t: " << N_t << endl;
-    dataFile << "# dx: " << dx << ", dt: " << dt << endl;
-    dataFile << "# x \t t \t phi \n";
     int time_resolution = 4;        // don't need to plot every time point
 
 
     // main experiment
-    for (int t = 0; t < N_t - 1; ++t)
+    for (int t = 0; t < N_t; ++t)
     {
-        // solve the set of linear equations
-        // (for a tridiagonal matrix)
-        tridag(a, b, c, u, u_next, N_x);         
-
-        // update the concentration
-        for (int i = 0; i < N_x; ++i)
-            u(i) = u_next(i);
-
-        // NOTE: here we are using Dirichlet BCs, i.e:
-        // u(0, t) = u(N_x - 1, t) = 0 for all t
-        u(0) = u(N_x - 1) = 0.0;
+        // write the data to file (every so often)
+        if (t % time_resolution == 0)
+        {
+            // adaptive steps don't stop at the output times: go on past
+            // this one and interpolate back to it
+            vector<double> *snapshot = &u;
+            if (adaptive && t > 0)
+            {
+                long long tick = (long long)t * dt_divisions;
+                while (stepper.ticks() < tick)
+                    if (!stepper.step(u)) return 1;
+                stepper.interpolate(tick, u, u_next);
+                snapshot = &u_next;
+            }
+
+            // check conservation of mass
+            double mass = 0.0;
+            for (int i = 0; i < N_x; ++i) mass += (*snapshot)(i);
+            cout << "mass at timestep " << t << " is: " << mass << endl;
+
+            output.write(t, t * dt, &(*snapshot)(0));
+        }
 
+        if (t == N_t - 1) break;
 
-        // check conservation of mass
-        double mass = 0.0;
-        for (int i = 0; i < N_x; ++i) mass += u(i);
-        cout << "mass at timestep " << t << " is: " << mass << endl;
+        if (adaptive) continue;
 
-        // and write the data to file (every so often)
-        if (t % time_resolution == 0)
+        if (parallel_solver)
         {
-            for (int x = 0; x < N_x; ++x) dataFile << x << "\t" << t << "\t" << u(x) << endl;
-            dataFile << endl;
+            scheme.step(*parallel_solver, dt, u, u_next);
+
+            if (verify_parallel && t == 0)
+            {
+                vector<double> check(N_x);
+                scheme.step(solver, dt, u, check);
+
+                double max_diff = 0.0;
+                for (int i = 0; i < N_x; ++i) max_diff = std::max(max_diff, std::fabs(check(i) - u_next(i)));
+                cout << "parallel solver: max difference from serial = " << max_diff << endl;
+            }
+            u.swap(u_next);
         }
+        else
+        {
+            scheme.step(solver, dt, u, u_next);
+            u.swap(u_next);
+        }
+    }
+
+    if (adaptive)
+    {
+        cout << "adaptive steps: " << stepper.accepted() << " accepted, " << stepper.rejected() << " rejected"
+             << " (" << N_t - 1 << " fixed steps), final dt = " << stepper.dt() << endl;
+        cout << "matrices factorised: " << stepper.factorisations() << endl;
+        if (stepper.forced()) cout << "warning: " << stepper.forced() << " steps above tolerance at the smallest dt" << endl;
     }
 
     // finish writing to file
-    dataFile.close();
+    output.close();
+    if (N_x <= text_limit) exportGnuplot("data/output.fld", "data/output.dat");
 
     return 0;
 }
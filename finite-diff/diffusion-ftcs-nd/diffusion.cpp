@@ -0,0 +1,116 @@
+#include <iostream>
+#include <memory>
+
+#include "field.h"
+#include "multigrid.h"
+#include "utilities/stencil.h"
+#include "fieldio.h"
+
+using namespace std;
+
+// FTCS, or backward Euler with each step solved by multigrid
+enum Method { EXPLICIT, IMPLICIT };
+
+int main (int, char **)
+{
+
+    int Nt = 2000;                    // number of timesteps
+    int Nx = 100, Ny = 100;          // number of spacial points
+    int Nz = 1;                      // set Nz > 1 for a 3D run
+    double dt = 0.01, dx = 0.01;     // timestep / spacial resolution
+    double D = 0.0001;             // diffusion const
+
+    int time_resolution = 100;       // don't need to plot every time point
+
+    // the implicit scheme is stable for any dt, and each step costs a
+    // few multigrid V cycles (grid sizes with a large power of two as a
+    // factor coarsen furthest, and so solve fastest)
+    int method = EXPLICIT;
+    double solver_tol = 1e-8;
+
+    // snapshots go to data/output.fld (deflated if compress is set), and
+    // for grids up to text_limit points also to data/output.dat for gnuplot
+    bool compress = false;
+    int text_limit = 100000;
+
+    // rows per cache tile (3D only)
+    int tile_y = 16;
+
+    // boundary conditions on each face, in the order x-, x+, y-, y+, z-, z+
+    Boundary bc[6] = {
+        {NEUMANN, 0.0}, {NEUMANN, 0.0},
+        {PERIODIC, 0.0}, {PERIODIC, 0.0},
+        {DIRICHLET, 0.0}, {DIRICHLET, 0.0}
+    };
+
+    // save calculating this at every step
+    double factor = D * dt / (dx * dx);
+    double fz = (Nz > 1) ? factor : 0.0;
+
+    // the explicit scheme is only stable for sum of factors <= 1/2
+    if (method == EXPLICIT && 2 * factor + fz > 0.5) cout << "warning: D dt / dx^2 too large, expect instability" << endl;
+
+    // only the current and next time levels are kept (for the implicit
+    // scheme u_next is the right hand side, i.e. the old level)
+    Field u(Nx, Ny, Nz), u_next(Nx, Ny, Nz);
+
+    // (I - D dt lap) u_new = u_old
+    unique_ptr<Multigrid> implicit;
+    if (method == IMPLICIT)
+    {
+        implicit.reset(new Multigrid(Nx, Ny, Nz, dx, bc, 1.0, D * dt));
+        cout << "implicit scheme, " << implicit->levelCount() << " multigrid levels" << endl;
+    }
+
+
+    // initialise system with a few drops of material
+    int kMid = Nz / 2;
+    u(int(0.4 * Nx), int(0.5 * Ny), kMid) = 1000;
+    u(int(0.6 * Nx), int(0.3 * Ny), kMid) = 1000;
+    u(int(0.1 * Nx), int(0.9 * Ny), kMid) = 1000;
+
+    // write results to file as we go, in the background (the gnuplot
+    // copy has one block per snapshot, showing the middle plane in 3D)
+    FieldInfo info(Nx, Ny, Nz);
+    info.set("D", D);
+    info.set("Nt", Nt);
+    info.set("dx", dx);
+    info.set("dt", dt);
+    FieldWriter output("data/output.fld", info, compress);
+    if (!output.good()) return 1;
+
+    // main experiment
+    for (int t = 0; t < Nt; ++t)
+    {
+        applyBoundaries(u, bc);
+
+        // write a snapshot (every so often)
+        if (t % time_resolution == 0)
+        {
+            output.write(t, t * dt, &u(0, 0, 0), u.strideY(), u.strideZ());
+
+            // with Dirichlet walls material can leave the system
+            cout << "mass at step " << t << " is: " << totalMass(u) << endl;
+        }
+
+        if (method == IMPLICIT)
+        {
+            u_next.swap(u);
+            copyInterior(u_next, u);
+
+            // starting from the old level, which is already close
+            if (implicit->solve(u, u_next, solver_tol, 50, Multigrid::V_CYCLE, false) < 0)
+                cout << "warning: multigrid did not converge at step " << t << endl;
+        }
+        else
+        {
+            ftcsStep(u, u_next, factor, factor, fz, tile_y);
+            u.swap(u_next);
+        }
+    }
+
+    output.close();
+    if (Nx * Ny <= text_limit) exportGnuplot("data/output.fld", "data/output.dat");
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef STENCIL_H
+#define STENCIL_H
+
+#include <algorithm>
+#include "field.h"
+
+/* The 5 point (2D) and 7 point (3D) FTCS updates for one row of nx
+   cells, where c points at the first cell of the row in the current
+   level and o at the same cell in the next level.
+*/
+inline void ftcsRow2D(const double * __restrict__ c, double * __restrict__ o, int nx,
+                      double fx, double fy, std::ptrdiff_t sy)
+{
+    #pragma omp simd
+    for (int i = 0; i < nx; ++i)
+        o[i] = c[i] + fx * (c[i + 1] + c[i - 1] - 2 * c[i])
+                    + fy * (c[i + sy] + c[i - sy] - 2 * c[i]);
+}
+
+inline void ftcsRow3D(const double * __restrict__ c, double * __restrict__ o, int nx,
+                      double fx, double fy, double fz, std::ptrdiff_t sy, std::ptrdiff_t sz)
+{
+    #pragma omp simd
+    for (int i = 0; i < nx; ++i)
+        o[i] = c[i] + fx * (c[i + 1] + c[i - 1] - 2 * c[i])
+                    + fy * (c[i + sy] + c[i - sy] - 2 * c[i])
+                    + fz * (c[i + sz] + c[i - sz] - 2 * c[i]);
+}
+
+
+/* One FTCS step of the whole field, reading u (whose halo must already
+   be filled) and writing the interior of u_next. fx, fy, fz are
+   D dt / dx^2 etc. in each direction.
+
+   Each thread works through its own slab. In 3D the slab is further
+   cut into strips of tile_y rows, and a strip is swept through all the
+   planes of the slab before moving on, so the three planes the stencil
+   needs (k - 1, k, k + 1) are only tile_y rows each and stay in cache.
+*/
+inline void ftcsStep(const Field &u, Field &u_next, double fx, double fy, double fz, int tile_y)
+{
+    const int nx = u.nx(), ny = u.ny();
+    const std::ptrdiff_t sy = u.strideY(), sz = u.strideZ();
+    const bool threeD = (u.dims() == 3);
+
+    #pragma omp parallel
+    {
+        int lo, hi;
+        slabRange(u.slabs(), lo, hi);
+
+        if (threeD)
+        {
+            for (int jb = 0; jb < ny; jb += tile_y)
+                for (int k = lo; k < hi; ++k)
+                    for (int j = jb; j < std::min(ny, jb + tile_y); ++j)
+                    {
+                        std::ptrdiff_t n = u.index(0, j, k);
+                        ftcsRow3D(u.data() + n, u_next.data() + n, nx, fx, fy, fz, sy, sz);
+                    }
+        }
+        else
+        {
+            for (int j = lo; j < hi; ++j)
+            {
+                std::ptrdiff_t n = u.index(0, j, 0);
+                ftcsRow2D(u.data() + n, u_next.data() + n, nx, fx, fy, sy);
+            }
+        }
+    }
+}
+
+
+// total amount of material in the interior of the field
+inline double totalMass(const Field &u)
+{
+    const int nx = u.nx(), ny = u.ny(), nz = u.nz();
+    double mass = 0.0;
+
+    #pragma omp parallel for reduction(+:mass) schedule(static)
+    for (int k = 0; k < nz; ++k)
+        for (int j = 0; j < ny; ++j)
+            for (int i = 0; i < nx; ++i)
+                mass += u(i, j, k);
+
+    return mass;
+}
+
+#endif
@@ -1,7 +1,9 @@
-#include <boost/numeric/ublas/matrix.hpp>
-using boost::numeric::ublas::matrix;
 #include <iostream>
-#include <fstream>
+#include <vector>
+#include <algorithm>
+
+#include "utilities/stencil.h"
+#include "fieldio.h"
 
 using namespace std;
 
@@ -13,60 +15,66 @@ int main (int, char **)
     double dt = 0.01, dx = 0.01;     // timestep / spacial resolution
     double D = 0.0001;             // diffusion const
 
+    int time_resolution = 30;        // don't need to plot every time point
+
+    // snapshots go to data/output.fld (deflated if compress is set), and
+    // for grids up to text_limit points also to data/output.dat for gnuplot
+    bool compress = false;
+    int text_limit = 100000;
+
+    // the grid is updated in tiles of tile_width points, each taken
+    // through up to block_steps timesteps at once while in cache
+    int tile_width = 4096;
+    int block_steps = 16;
+
+    // NOTE: here we are using Neumann BCs, i.e:
+    // du(0, t)/dx = du(Nx - 1, t)/dx = 0 for all t
+    // (any of the conditions in stencil1d.h can be used at either end)
+    Neumann lo_bc, hi_bc;
+
     // save calculating this at every step
     double factor = D * dt / (dx * dx);
 
-    // track for all times (only 2 rows needed in reality)
-    matrix<double> grid(Nx, Nt);
+    // only the current and next time levels are kept, and
+    // the two buffers swap roles after every step
+    vector<double> level_a(Nx), level_b(Nx), work;
+    double *u = &level_a[0], *u_next = &level_b[0];
 
 
     // initialise system with an initial drop of material in the middle
-    grid(int(0.4 * Nx), 0) = 100;
-    grid(int(0.6 * Nx), 0) = 100;
-    grid(int(0.1 * Nx), 0) = 100;
-
-    // main experiment
-    for (int t = 0; t < Nt - 1; ++t)
+    u[int(0.4 * Nx)] = 100;
+    u[int(0.6 * Nx)] = 100;
+    u[int(0.1 * Nx)] = 100;
+    fillGhosts(u, Nx, lo_bc, hi_bc);
+
+    // write results to file as we go, in the background
+    FieldInfo info(Nx);
+    info.set("D", D);
+    info.set("Nt", Nt);
+    info.set("dx", dx);
+    info.set("dt", dt);
+    FieldWriter output("data/output.fld", info, compress);
+    if (!output.good()) return 1;
+
+    // main experiment, one snapshot interval at a time
+    for (int t = 0; t < Nt; t += time_resolution)
     {
+        // write a snapshot
+        output.write(t, t * dt, u);
 
-        // NOTE: here we are using Neumann BCs, i.e:
-        // du(0, t)/dx = du(Nx - 1, t)/dx = 0 for all t
-        grid(0, t) = grid(1, t);
-        grid(Nx - 1, t) = grid(Nx - 2, t);
-
-        for (int i = 1; i < Nx - 1; ++i)
-        {
-            grid(i, t + 1) = grid(i, t) + factor *
-                             (grid(i + 1, t) + grid(i - 1, t) - 2 * grid(i, t));
-        }
-
-        
-        // check conservation of mass, remembering to ignore the 
+        // check conservation of mass, remembering to ignore the
         // boundary points!
         double mass = 0.0;
-        for (int i = 1; i < Nx - 1; ++i) mass += grid(i, t);
+        for (int i = 1; i < Nx - 1; ++i) mass += u[i];
         cout << "mass at step " << t << " is: " << mass << endl;
-    }
 
-
-
-    // write results to file, starting with a header for GNUPLOT
-    ofstream dataFile;
-    dataFile.open("data/output.dat", ios::trunc);
-    dataFile << "# D: " << D << ", Nx: " << Nx << ", Nt: " << Nt << endl;
-    dataFile << "# dx: " << dx << ", dt: " << dt << endl;
-    dataFile << "# x \t t \t phi \n";
-
-    int time_resolution = 30;        // don't need to plot every time point
-
-    for (int t = 0; t < Nt; t += time_resolution)
-    {
-        for (int x = 0; x < Nx; ++x) dataFile << x << "\t" << t << "\t" << grid(x, t) << endl;
-
-        dataFile << endl;
+        // then on to the next snapshot (or the end)
+        int steps = min(time_resolution, Nt - 1 - t);
+        ftcsAdvance(u, u_next, Nx, factor, steps, tile_width, block_steps, work, lo_bc, hi_bc);
     }
 
-    dataFile.close();
+    output.close();
+    if (Nx <= text_limit) exportGnuplot("data/output.fld", "data/output.dat");
+
     return 0;
 }
-
@@ -0,0 +1,85 @@
+#include <vector>
+#include <algorithm>
+
+#include "stencil1d.h"
+
+/* Advance the whole grid by "steps" timesteps, with the boundary
+   conditions lo / hi (see stencil1d.h) regenerating the ghost points
+   0 and Nx - 1 before every step.
+
+   Rather than sweeping the whole grid once per timestep (so every
+   step streams the grid through memory), the grid is cut into tiles
+   of tile_width points and each tile is taken through up to
+   block_steps steps while it sits in cache. To advance a tile by T
+   steps we need T extra points on either side (the "ghost zone"),
+   which are recomputed by both neighbouring tiles; the region we can
+   trust shrinks by one point at each end per step, until after T
+   steps it is exactly the tile. This gives the same numbers as the
+   plain step by step sweep, bit for bit.
+
+   A periodic ghost needs the far end of the grid at the same time
+   level, which a tile at one end doesn't have after the first step,
+   so periodic grids are advanced one step at a time.
+
+   On return u holds the new time level (the two pointers are swapped
+   as needed) with its ghost points filled, and work is used as scratch
+   space for the tiles.
+*/
+template <class Lo, class Hi>
+inline void ftcsAdvance(double *&u, double *&u_next, int Nx, double factor, int steps,
+                        int tile_width, int block_steps, std::vector<double> &work,
+                        const Lo &lo_bc, const Hi &hi_bc)
+{
+    if (Lo::periodic || Hi::periodic) block_steps = 1;
+
+    while (steps > 0)
+    {
+        int T = std::min(steps, block_steps);
+
+        work.resize(2 * (tile_width + 2 * T));
+
+        for (int lo = 0; lo < Nx; lo += tile_width)
+        {
+            int hi = std::min(Nx, lo + tile_width);
+
+            // region of the grid copied into the tile (global indices)
+            int L = std::max(0, lo - T), R = std::min(Nx, hi + T);
+
+            // a and b are the two time levels of the tile, with
+            // a[i - L] holding grid point i
+            double *a = &work[0];
+            double *b = &work[tile_width + 2 * T];
+
+            std::copy(u + L, u + R, a);
+
+            // the points we can trust at the current level
+            int valid_lo = L, valid_hi = R;
+
+            for (int s = 0; s < T; ++s)
+            {
+                // at the ends of the grid the BCs regenerate the
+                // boundary points, so nothing is lost there
+                // (u is only read here for periodic grids, when T = 1)
+                if (L == 0) a[0] = lo_bc.ghost(a[1], u[Nx - 2]);
+                if (R == Nx) a[Nx - 1 - L] = hi_bc.ghost(a[Nx - 2 - L], u[1]);
+
+                int first = std::max(1, valid_lo + 1);
+                int last = std::min(Nx - 1, valid_hi - 1);
+
+                ftcsRange(a, b, first - L, last - L, factor);
+
+                if (L > 0) valid_lo = first;
+                if (R < Nx) valid_hi = last;
+
+                std::swap(a, b);
+            }
+
+            std::copy(a + (lo - L), a + (hi - L), u_next + lo);
+        }
+
+        std::swap(u, u_next);
+        steps -= T;
+    }
+
+    fillGhosts(u, Nx, lo_bc, hi_bc);
+}
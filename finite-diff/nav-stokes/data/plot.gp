@@ -0,0 +1,9 @@
+set title "Lid driven cavity (speed, final snapshot)"
+set xlabel "cell (x)"
+set ylabel "cell (y)"
+set cblabel "speed |u|"
+set pm3d map
+set nokey
+set size square
+stats "output.dat" using 3 nooutput
+splot 	"output.dat" index (STATS_blocks - 1) using 1:2:3 with pm3d
@@ -1,89 +1,213 @@
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <algorithm>
 #include <cmath>
-#include <boost/numeric/ublas/matrix.hpp>
-#include <boost/numeric/ublas/io.hpp>
 
-using namespace boost::numeric::ublas;
+#include "field.h"
+#include "multigrid.h"
+#include "fieldio.h"
+#include "utilities/mac.h"
+#include "utilities/poisson.h"
+
 using std::cout;
+using std::endl;
 
+// how the viscous terms are stepped
+enum Viscosity { EXPLICIT, IMPLICIT };
 
+// how the pressure equation is solved
+enum Pressure { MULTIGRID, SPECTRAL };
 
-int main (int /*argc*/, char ** /*argv*/) 
+int main (int, char **)
 {
 
-    // number of internal spacial points
-    int N = 5;
+    int N = 128;                     // number of cells in each direction
+    double L = 1.0;                  // side of the (square) cavity
+    double Re = 100.0;               // Reynolds number, lid speed * L / nu
+    double lid = 1.0;                // velocity of the top wall
+
+    double t_max = 50.0;             // time to run to (at most)
+
+    int time_resolution = 250;       // don't need to plot every step
+
+    // with explicit viscosity dt must also be below h^2 Re / 4; the
+    // implicit option lifts that limit, leaving only the CFL condition
+    int viscosity = IMPLICIT;
+
+    // timestep: with adaptive set, every step takes cfl times the largest
+    // stable step (for convection, and diffusion if it is explicit), up
+    // to dt_max; otherwise every step is dt_max
+    bool adaptive = true;
+    double cfl = 0.5;
+    double dt_max = 0.01;
+
+    // stop early once the flow has settled: when the largest change of
+    // u or v per unit time (in units of lid^2 / L) drops below steady_tol
+    double steady_tol = 1e-5;
+
+    // the spectral solver is direct (cosine transforms, O(N log N)); the
+    // multigrid one iterates to solver_tol, relative to the size of div(u).
+    // What it leaves behind shows up in the residual above (about 30 times
+    // solver_tol), so solver_tol must be well below steady_tol
+    int pressure_solver = SPECTRAL;
+    double solver_tol = 1e-9;
+
+    // snapshots of the speed go to data/output.fld (deflated if compress is
+    // set), and for grids up to text_limit points also to data/output.dat
+    bool compress = false;
+    int text_limit = 100000;
+
+    // columns per cache tile of the momentum kernel
+    int tile_x = 256;
+
+    double h = L / N;
+    double nu = lid * L / Re;
+
+    cout << "lid driven cavity, " << N << " x " << N << " cells, Re = " << Re << endl;
+    if (!adaptive && lid * dt_max / h > 1.0)
+        cout << "warning: CFL number " << lid * dt_max / h << " above 1, expect instability" << endl;
+    if (!adaptive && viscosity == EXPLICIT && nu * dt_max / (h * h) > 0.25)
+        cout << "warning: nu dt / h^2 too large for explicit viscosity, expect instability" << endl;
+
+
+    /* The projection method of the notes. Each step
+       1. moves u, v by the nonlinear terms (and the viscous terms, if
+          explicit), giving u*,
+       2. for implicit viscosity, solves (I - nu dt lap) u** = u*,
+       3. solves lap(p) = div(u**) / dt, with dp/dn = 0 at the walls,
+       4. sets u = u** - dt grad(p), which is divergence free.
+       The pressure solve either transforms to the cosine modes of the
+       grid, in which the Laplacian is diagonal (utilities/poisson.h), or
+       uses the multigrid solver in ../common, started from the previous
+       step's pressure, which is already close.
+    */
+    Walls walls = { 0.0, lid, 0.0, 0.0 };
+    Boundary u_bc[6], v_bc[6];
+    velocityBoundaries(walls, u_bc, v_bc);
+
+    Boundary p_bc[6] = {
+        {NEUMANN, 0.0}, {NEUMANN, 0.0},
+        {NEUMANN, 0.0}, {NEUMANN, 0.0},
+        {NEUMANN, 0.0}, {NEUMANN, 0.0}
+    };
+
+    Field u(N + 1, N, 1), v(N, N + 1, 1), p(N, N, 1);
+    Field u_next(N + 1, N, 1), v_next(N, N + 1, 1), rhs(N, N, 1), speed(N, N, 1);
+
+    std::unique_ptr<SpectralPoisson> spectral;
+    std::unique_ptr<Multigrid> multigrid;
+    if (pressure_solver == SPECTRAL)
+    {
+        spectral.reset(new SpectralPoisson(N, N, h, p_bc));
+        cout << "pressure solve: cosine transforms" << endl;
+    }
+    else
+    {
+        multigrid.reset(new Multigrid(N, N, 1, h, p_bc));
+        cout << "pressure solve: " << multigrid->levelCount() << " multigrid levels" << endl;
+    }
+
+    MomentumKernel momentum(N, N, tile_x);
+    ViscousSolver viscous(N, N, walls);
+
+
+    // write results to file as we go, in the background
+    FieldInfo info(N, N);
+    info.set("Re", Re);
+    info.set("t_max", t_max);
+    info.set("dx", h);
+    info.set("dt_max", dt_max);
+    info.set("cfl", adaptive ? cfl : 0.0);
+    info.set("quantity", "speed");
+    FieldWriter output("data/output.fld", info, compress);
+    if (!output.good()) return 1;
 
-    // time / spacial resolution
-    double dt = 0.1, dx = 0.1, dy = 0.1;
-    double t = 0.0, t_max = 10.0;
 
-    // total number of spacial points
-    // including boundaries
-    int n_x, n_y;
-    n_x = n_y = (N + 2);
+    // the speed of the walls counts towards the CFL condition too
+    double wall_speed = std::max(std::max(std::fabs(walls.bottom), std::fabs(walls.top)),
+                                 std::max(std::fabs(walls.left), std::fabs(walls.right)));
 
-    // grid for pressure
-    matrix<double> p(n_x, n_y);
-    // grids for x / y components of velocity
-    matrix<double> u(n_x - 1, n_y), v(n_x, n_y - 1);
+    // main experiment
+    StepStats stats = { 0.0, 0.0, 0.0 };
+    double time = 0.0, dt = dt_max, residual = 0.0;
+    bool steady = false;
 
-    cout << u << " " << v;
- 
-    while (t < t_max)
+    for (int step = 0; ; ++step)
     {
-        /* Some comments on the index notation, particularly due to the
-           shifted grid. The pressure grid index notation just maps 
-           straight onto the array notation:
-           
-           p(i, j) -> p(i, j)
-           
-           Velocity components u and v are shifted by 1/2 in one dimension
-           only (i and j dimensions respectively). Clearly this notation
-           can't directly map to an array notation, so instead we use:
-
-           u(i+1/2, j) -> u(i, j)     ex.  u(1/2, 0) -> u(0, 0) etc
-           v(i, j+1/2) -> v(i, j)     ex.  v(1, 1/2) -> v(1, 0) etc
-
-        */
-
-        // Apply boundary conditions
-        // In reality this is v(i, 1/2) = 0 
-        for (int i = 1; i < (n_x - 1); ++i) v(i, 0) = 0;
-        // In reality this is u(1/2, j) = 0 
-        for (int j = 1; j < (n_y - 1); ++j) u(i, 0) = 0;
-        
-
-        for (int i = 1; i < (n_x - 1); ++i)
+        applyBoundaries(u, u_bc);
+        applyBoundaries(v, v_bc);
+
+        bool last = steady || t_max - time < 1e-6 * dt;
+
+        // write a snapshot (every so often)
+        if (step % time_resolution == 0 || last)
+        {
+            double energy = cellSpeed(u, v, speed, h);
+            output.write(step, time, &speed(0, 0), speed.strideY(), 0);
+            cout << "t = " << time << "\tdt = " << dt << "\tkinetic energy " << energy
+                 << "\tresidual " << residual << endl;
+        }
+
+        if (last) break;
+
+        // the largest stable step, from the velocities of the last one
+        if (adaptive)
+        {
+            double rate = (std::max(stats.u_max, wall_speed) + stats.v_max) / h;
+            if (viscosity == EXPLICIT) rate = std::max(rate, 4 * nu / (h * h));
+            dt = std::min(dt_max, cfl / rate);
+        }
+        dt = std::min(dt, t_max - time);
+
+        // blend in upwinding where the flow crosses a good part of a cell per step
+        double gamma = std::min(1.2 * dt * std::max(stats.u_max, stats.v_max) / h, 1.0);
+
+        momentum.step(u, v, u_next, v_next, dt, h, viscosity == EXPLICIT ? nu : 0.0, gamma);
+        u.swap(u_next);
+        v.swap(v_next);
+
+        // (only refactorised when dt has changed)
+        if (viscosity == IMPLICIT)
         {
-            for (int j = 1; j < (n_y - 1); ++j)
-            {
-                double viscous_term_u = (u(i-1, j) + u(i+1, j) - 2 * u(i, j)) / dx2
-                                      + (u(i, j-1) + u(i, j+1) - 2 * u(i, j)) / dy2
-                double viscous_term_v = (v(i-1, j) + v(i+1, j) - 2 * v(i, j)) / dx2
-                                      + (v(i, j-1) + v(i, j+1) - 2 * v(i, j)) / dy2
-                
-                double pressure_term_u = (p(i+1, j) - p(i, j)) / dx;
-                double pressure_term_v = (p(i+1, j) - p(i, j)) / dy;
-
-                double convective_a_u = (0.25 / dx) * ((u(i+1, j) + u(i, j)) ** 2
-                                                     + (u(i, j) + u(i-1, j)) ** 2);
-                double convective_a_v = (0.25 / dy) * ((v(i+1, j) + v(i, j)) ** 2
-                                                     + (v(i, j) + v(i-1, j)) ** 2);
-                
-                convective_a_u += (0.25 / dy) * ((u(i, j) + u(i, j+1)) * (v(i, j) + v(i+1, j))
-                                               - (u(i, j) + u(i, j-1)) * (v(i, j) + v(i+1, j)));
-
-                convective_a_v += (0.25 / dx) * ((u(i, j) + u(i, j+1)) * (v(i, j) + v(i+1, j))
-                                               - (u(i, j) + u(i, j-1)) * (v(i, j) + v(i+1, j)));
-
-                u(i, j) = 
-                    
-            }
+            viscous.setFactor(nu * dt / (h * h));
+            viscous.solve(u, v);
         }
 
-        t += dt;
+        divergence(u, v, rhs, 1.0 / (h * dt));
+        if (pressure_solver == SPECTRAL) spectral->solve(p, rhs);
+        else if (multigrid->solve(p, rhs, solver_tol, 50, Multigrid::V_CYCLE, false) < 0)
+            cout << "warning: pressure solve did not converge at step " << step << endl;
+
+        // u_next / v_next still hold the velocity from before the step
+        stats = subtractGradient(u, v, p, dt / h, u_next, v_next);
+        time += dt;
+
+        residual = stats.change / dt * L / (lid * lid);
+        if (residual < steady_tol)
+        {
+            steady = true;
+            cout << "steady state reached after " << step + 1 << " steps" << endl;
+        }
     }
+
+    if (!steady && pressure_solver == MULTIGRID)
+        cout << "warning: not steady by t_max, which may be the error left by the pressure solve:"
+             << " try a smaller solver_tol" << endl;
+
+    output.close();
+    if (N * N <= text_limit) exportGnuplot("data/output.fld", "data/output.dat");
+
+
+    // velocity along the centre lines, to compare with e.g. Ghia et al. (1982)
+    std::ofstream centre("data/centreline.dat");
+    centre << "# y \t u(x = L/2) \t x \t v(y = L/2)" << endl;
+    for (int j = 0; j < N; ++j)
+    {
+        double uc = (N % 2 == 0) ? u(N / 2, j) : 0.5 * (u(N / 2, j) + u(N / 2 + 1, j));
+        double vc = (N % 2 == 0) ? v(j, N / 2) : 0.5 * (v(j, N / 2) + v(j, N / 2 + 1));
+        centre << (j + 0.5) * h << "\t" << uc / lid << "\t" << (j + 0.5) * h << "\t" << vc / lid << endl;
+    }
+
     return 0;
 }
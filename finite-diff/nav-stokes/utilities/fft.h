@@ -0,0 +1,274 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <algorithm>
+
+typedef std::complex<double> Complex;
+
+/* Complex product, written out: std::complex's operator* has to allow
+   for infinities and NaNs and compiles to a library call (unless
+   -ffast-math is on), which would dominate the cost of a transform.
+*/
+inline Complex mul(const Complex &a, const Complex &b)
+{
+    return Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+/* Complex FFT of a fixed length n, for any n.
+
+   n is split into factors of 4, 2, 3, 5 and then whatever primes are
+   left, and the transform is done one factor (radix) at a time by the
+   Stockham algorithm, which reads one buffer and writes the other so
+   the output comes out in order without a bit reversal pass. Radices 2
+   and 4 have their own butterflies; the rest use a short direct DFT,
+   so a large prime factor p costs O(n p) rather than O(n log n).
+
+   Everything which only depends on n (the factors and all the twiddle
+   factors) is worked out once when the plan is built, so a plan should
+   be kept and reused for every transform of that length.
+*/
+class FFT
+{
+    public:
+        explicit FFT(int n) : n(n)
+        {
+            int rest = n;
+            for (int p = 4; p > 1; p -= 2)
+                while (rest % p == 0) { radix.push_back(p); rest /= p; }
+            for (int p = 3; rest > 1; p += 2)
+                while (rest % p == 0) { radix.push_back(p); rest /= p; }
+
+            // stage s has m = n / (l p) butterflies of p points each, and
+            // butterfly b multiplies its output t by w^(b t), w = e^(-2 pi i / (m p))
+            int l = 1;
+            for (std::size_t s = 0; s < radix.size(); ++s)
+            {
+                int p = radix[s], len = n / l, m = len / p;
+                offset.push_back(int(twiddle.size()));
+                for (int b = 0; b < m; ++b)
+                    for (int t = 1; t < p; ++t) twiddle.push_back(root(len, b * t));
+
+                // and the p-th roots of unity for the direct DFT
+                root_offset.push_back(int(roots.size()));
+                if (p != 2 && p != 4)
+                    for (int k = 0; k < p; ++k) roots.push_back(root(p, k));
+                l *= p;
+            }
+        }
+
+        int size() const { return n; }
+
+        /* Forward transform X_k = sum x_j e^(-2 pi i j k / n) of data, in
+           place, using work (also n long) as the other buffer. The
+           inverse is the same with e^(+...) and no 1/n.
+        */
+        void forward(Complex *data, Complex *work) const { transform(data, work, false); }
+        void inverse(Complex *data, Complex *work) const { transform(data, work, true); }
+
+    private:
+        int n;
+        std::vector<int> radix, offset, root_offset;
+        std::vector<Complex> twiddle, roots;
+
+        static Complex root(int len, int k)
+        {
+            const double angle = -2 * M_PI * double(k % len) / len;
+            return Complex(std::cos(angle), std::sin(angle));
+        }
+
+        void transform(Complex *data, Complex *work, bool inverse) const
+        {
+            if (inverse) for (int j = 0; j < n; ++j) data[j] = std::conj(data[j]);
+
+            Complex *x = data, *y = work;
+            int stride = 1;
+            for (std::size_t s = 0; s < radix.size(); ++s)
+            {
+                const int p = radix[s], m = n / (stride * p);
+                const Complex *w = &twiddle[offset[s]];
+
+                if (p == 4) stage4(x, y, m, stride, w);
+                else if (p == 2) stage2(x, y, m, stride, w);
+                else stageN(x, y, p, m, stride, w, &roots[root_offset[s]]);
+
+                std::swap(x, y);
+                stride *= p;
+            }
+
+            if (x != data) std::copy(x, x + n, data);
+            if (inverse) for (int j = 0; j < n; ++j) data[j] = std::conj(data[j]);
+        }
+
+        static void stage2(const Complex *x, Complex *y, int m, int s, const Complex *w)
+        {
+            for (int b = 0; b < m; ++b)
+            {
+                const Complex wb = w[b];
+                for (int q = 0; q < s; ++q)
+                {
+                    const Complex a0 = x[q + s * b], a1 = x[q + s * (b + m)];
+                    y[q + s * (2 * b)] = a0 + a1;
+                    y[q + s * (2 * b + 1)] = mul(a0 - a1, wb);
+                }
+            }
+        }
+
+        static void stage4(const Complex *x, Complex *y, int m, int s, const Complex *w)
+        {
+            for (int b = 0; b < m; ++b)
+            {
+                const Complex w1 = w[3 * b], w2 = w[3 * b + 1], w3 = w[3 * b + 2];
+                for (int q = 0; q < s; ++q)
+                {
+                    const Complex a0 = x[q + s * b], a1 = x[q + s * (b + m)];
+                    const Complex a2 = x[q + s * (b + 2 * m)], a3 = x[q + s * (b + 3 * m)];
+
+                    // multiplying by -i is a swap and a sign change
+                    const Complex e = a0 + a2, f = a0 - a2, g = a1 + a3;
+                    const Complex d = a1 - a3, mid(d.imag(), -d.real());
+
+                    Complex *o = y + q + s * (4 * b);
+                    o[0] = e + g;
+                    o[s] = mul(f + mid, w1);
+                    o[2 * s] = mul(e - g, w2);
+                    o[3 * s] = mul(f - mid, w3);
+                }
+            }
+        }
+
+        static void stageN(const Complex *x, Complex *y, int p, int m, int s,
+                           const Complex *w, const Complex *rp)
+        {
+            Complex a[64];
+            std::vector<Complex> big(p > 64 ? p : 0);
+            Complex *in = (p > 64) ? &big[0] : a;
+
+            for (int b = 0; b < m; ++b)
+            {
+                for (int q = 0; q < s; ++q)
+                {
+                    for (int r = 0; r < p; ++r) in[r] = x[q + s * (b + r * m)];
+
+                    for (int t = 0; t < p; ++t)
+                    {
+                        Complex sum = in[0];
+                        for (int r = 1; r < p; ++r) sum += mul(in[r], rp[r * t % p]);
+                        y[q + s * (p * b + t)] = (t == 0) ? sum : mul(sum, w[(p - 1) * b + t - 1]);
+                    }
+                }
+            }
+        }
+};
+
+
+/* Fast cosine (DCT-II) and sine (DST-II) transforms of real data of
+   length n, and their inverses, built on an FFT of length n:
+
+       DCT:  X_k = sum x_j cos(pi k (j + 1/2) / n)
+       DST:  X_k = sum x_j sin(pi (k + 1) (j + 1/2) / n)
+
+   These diagonalise the second difference on a cell centred grid with
+   zero gradient (DCT) or zero value (DST) at the walls half a cell
+   outside the end points. The data is reordered (even points forwards,
+   odd points backwards) so the DCT is the real part of a rotated FFT
+   (Makhoul, 1980), and the DST is a DCT of the data with alternate signs
+   flipped, read backwards.
+
+   Two real lines are transformed at once as the real and imaginary
+   parts of one Complex line and separated afterwards, which halves the
+   cost. The inverses include the 1 / n, so inverse(forward(x)) = x.
+*/
+class RealTransform
+{
+    public:
+        RealTransform(int n, bool sine) : n(n), sine(sine), fft(n), rotation(n)
+        {
+            for (int k = 0; k < n; ++k)
+            {
+                const double angle = -M_PI * k / (2.0 * n);
+                rotation[k] = Complex(std::cos(angle), std::sin(angle));
+            }
+        }
+
+        int size() const { return n; }
+
+        /* Transform the lines a and b (n values each, b may be 0) in
+           place; z and work are scratch space of n Complex values.
+        */
+        void forward(double *a, double *b, Complex *z, Complex *work) const
+        {
+            for (int j = 0; 2 * j < n; ++j)
+            {
+                z[j] = Complex(in(a, 2 * j), b ? in(b, 2 * j) : 0.0);
+                if (2 * j + 1 < n) z[n - 1 - j] = Complex(in(a, 2 * j + 1), b ? in(b, 2 * j + 1) : 0.0);
+            }
+
+            fft.forward(z, work);
+
+            // a's transform is the Hermitian part of z, b's the rest
+            for (int k = 0; k < n; ++k)
+            {
+                const Complex zk = z[k], zc = std::conj(z[k == 0 ? 0 : n - k]);
+                const Complex d = zk - zc;
+                const Complex va = 0.5 * (zk + zc), vb(0.5 * d.imag(), -0.5 * d.real());
+
+                out(a, k, mul(va, rotation[k]).real());
+                if (b) out(b, k, mul(vb, rotation[k]).real());
+            }
+        }
+
+        void inverse(double *a, double *b, Complex *z, Complex *work) const
+        {
+            const double scale = 1.0 / n;
+
+            for (int k = 0; k < n; ++k)
+            {
+                // undo the rotation using the partner coefficient n - k
+                const Complex back = std::conj(rotation[k]);
+                const Complex va = mul(Complex(coeff(a, k), k ? -coeff(a, n - k) : 0.0), back);
+                const Complex vb = b ? mul(Complex(coeff(b, k), k ? -coeff(b, n - k) : 0.0), back) : Complex(0.0);
+                z[k] = Complex(va.real() - vb.imag(), va.imag() + vb.real());
+            }
+
+            fft.inverse(z, work);
+
+            for (int j = 0; 2 * j < n; ++j)
+            {
+                store(a, 2 * j, scale * z[j].real());
+                if (b) store(b, 2 * j, scale * z[j].imag());
+                if (2 * j + 1 < n)
+                {
+                    store(a, 2 * j + 1, scale * z[n - 1 - j].real());
+                    if (b) store(b, 2 * j + 1, scale * z[n - 1 - j].imag());
+                }
+            }
+        }
+
+        /* Eigenvalue of the second difference (times h^2) belonging to
+           transform coefficient k, i.e. -4 sin^2(pi k / 2n) for the DCT
+           and the same with k + 1 for the DST.
+        */
+        double eigenvalue(int k) const
+        {
+            const double s = std::sin(M_PI * (sine ? k + 1 : k) / (2.0 * n));
+            return -4 * s * s;
+        }
+
+    private:
+        int n;
+        bool sine;
+        FFT fft;
+        std::vector<Complex> rotation;
+
+        // the DST works on a DCT of x_j (-1)^j, whose coefficients come
+        // out (and go back in) in reverse order
+        double in(const double *x, int j) const { return (sine && (j & 1)) ? -x[j] : x[j]; }
+        void out(double *x, int k, double value) const { x[sine ? n - 1 - k : k] = value; }
+        double coeff(const double *x, int k) const { return x[sine ? n - 1 - k : k]; }
+        void store(double *x, int j, double value) const { x[j] = (sine && (j & 1)) ? -value : value; }
+};
+
+#endif
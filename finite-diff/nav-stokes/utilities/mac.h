@@ -0,0 +1,448 @@
+#ifndef MAC_H
+#define MAC_H
+
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "field.h"
+#include "maths.h"
+
+/* The staggered ("MAC") grid of the MIT 18.086 notes, for nx x ny
+   square cells of width h. Pressure lives at the cell centres and each
+   velocity component on the cell faces normal to it:
+
+       p(i, j)  at ((i + 1/2) h, (j + 1/2) h),   p: Field(nx, ny)
+       u(i, j)  at (i h, (j + 1/2) h),           u: Field(nx + 1, ny)
+       v(i, j)  at ((i + 1/2) h, j h),           v: Field(nx, ny + 1)
+
+   so u(0, j) and u(nx, j) (v(i, 0) and v(i, ny)) sit on the walls and
+   hold the normal velocity there, which is zero and never updated. The
+   tangential velocity at a wall lies half way between an edge value and
+   its ghost in the halo, exactly like a DIRICHLET face of a cell
+   centred Field, so applyBoundaries() fills the ghosts.
+*/
+
+// tangential velocity of each wall (bottom / top move in x, left / right in y)
+struct Walls
+{
+    double bottom, top, left, right;
+};
+
+// halo conditions for u and v for the given wall velocities
+inline void velocityBoundaries(const Walls &walls, Boundary u_bc[6], Boundary v_bc[6])
+{
+    const Boundary u_faces[6] = {
+        {DIRICHLET, 0.0}, {DIRICHLET, 0.0},
+        {DIRICHLET, walls.bottom}, {DIRICHLET, walls.top},
+        {DIRICHLET, 0.0}, {DIRICHLET, 0.0}
+    };
+    const Boundary v_faces[6] = {
+        {DIRICHLET, walls.left}, {DIRICHLET, walls.right},
+        {DIRICHLET, 0.0}, {DIRICHLET, 0.0},
+        {DIRICHLET, 0.0}, {DIRICHLET, 0.0}
+    };
+    std::copy(u_faces, u_faces + 6, u_bc);
+    std::copy(v_faces, v_faces + 6, v_bc);
+}
+
+
+/* Flux of q carried by the velocity a across a face, where q_m and q_p
+   are the values of q either side of it and qa their average. gamma
+   blends the centred flux (gamma = 0) with donor cell upwinding
+   (gamma = 1), as in the notes.
+*/
+inline double flux(double a, double qa, double q_m, double q_p, double gamma)
+{
+    return a * qa - gamma * std::fabs(a) * 0.5 * (q_p - q_m);
+}
+
+
+/* The explicit part of a step: u_next = u + dt (nu lap(u) - (u.grad) u),
+   with the same for v, at every face which isn't on a wall. The
+   nonlinear terms are in conservative form, d(uu)/dx + d(uv)/dy and
+   d(uv)/dx + d(vv)/dy, so each is a difference of fluxes: uu and vv at
+   the cell centres, and uv at the cell corners, where it is carried by
+   v for the u equation and by u for the v equation. nu = 0 gives the
+   nonlinear terms only (for implicit viscosity). The halos of u and v
+   must already be filled.
+
+   Both components are updated in a single pass over the grid. Each
+   thread takes a slab of rows (as for forEachRow()), cut into strips of
+   tile columns, and sweeps each strip up its rows. Row j of u and of v
+   needs only rows j - 1 .. j + 1 of u and v, so everything is read from
+   cache once it has been loaded for the row below, and every flux is
+   worked out once: the fluxes on the top of row j (the corners at
+   j + 1 and the v cell centres between v rows j and j + 1) are kept for
+   the bottom of row j + 1. The loops along a row are plain arithmetic
+   on contiguous arrays and vectorise. Every thread keeps its own flux
+   rows, which are made with the kernel.
+*/
+class MomentumKernel
+{
+    public:
+        MomentumKernel(int nx, int ny, int tile) : nx(nx), ny(ny), tile(std::max(tile, 1))
+        {
+#ifdef _OPENMP
+            int threads = omp_get_max_threads();
+#else
+            int threads = 1;
+#endif
+            for (int t = 0; t < threads; ++t)
+                scratch.push_back(std::unique_ptr<Fluxes>(new Fluxes(nx)));
+        }
+
+        void step(const Field &u, const Field &v, Field &u_next, Field &v_next,
+                  double dt, double h, double nu, double gamma)
+        {
+            #pragma omp parallel
+            {
+                int lo, hi;
+                slabRange(ny, lo, hi);
+#ifdef _OPENMP
+                Fluxes &f = *scratch[omp_get_thread_num()];
+#else
+                Fluxes &f = *scratch[0];
+#endif
+                for (int i0 = 0; i0 < nx && lo < hi; i0 += tile)
+                {
+                    const int i1 = std::min(nx, i0 + tile);
+
+                    // corner row lo and centre row lo - 1 start the strip
+                    corners(u, v, lo, i0, i1, gamma, f.g_bot, f.k_cur);
+                    if (lo > 0) centres(v, lo - 1, i0, i1, gamma, f.h_below);
+
+                    for (int j = lo; j < hi; ++j)
+                    {
+                        corners(u, v, j + 1, i0, i1, gamma, f.g_top, f.k_next);
+                        centres(v, j, i0, i1, gamma, f.h_above);
+                        uRow(u, u_next, j, i0, i1, dt, h, nu, gamma, f);
+                        if (j > 0) vRow(v, v_next, j, i0, i1, dt, h, nu, f);
+
+                        f.g_bot.swap(f.g_top);
+                        f.k_cur.swap(f.k_next);
+                        f.h_below.swap(f.h_above);
+                    }
+                }
+            }
+        }
+
+    private:
+        // the flux rows of one thread (see step())
+        struct Fluxes
+        {
+            explicit Fluxes(int nx)
+                : g_bot(nx + 1), g_top(nx + 1), k_cur(nx + 1), k_next(nx + 1),
+                  h_below(nx), h_above(nx), f_x(nx + 1)
+            {
+            }
+
+            // uv at the corners below / above the current row, carried by
+            // v (g) or by u (k); vv at the v cell centres below / above;
+            // uu at the u cell centres, with f_x[c + 1] for cell c
+            std::vector<double> g_bot, g_top, k_cur, k_next, h_below, h_above, f_x;
+        };
+
+        int nx, ny, tile;
+        std::vector<std::unique_ptr<Fluxes> > scratch;
+
+        static const double *row(const Field &q, int j) { return q.data() + q.index(0, j, 0); }
+
+        // uv at the corners (i, j) for i = i0 .. i1 (the corner at i is at x = i h)
+        static void corners(const Field &u, const Field &v, int j, int i0, int i1, double gamma,
+                            std::vector<double> &g, std::vector<double> &k)
+        {
+            const double * __restrict__ ub = row(u, j - 1);
+            const double * __restrict__ ut = row(u, j);
+            const double * __restrict__ vr = row(v, j);
+            double * __restrict__ go = &g[0];
+            double * __restrict__ ko = &k[0];
+
+            #pragma omp simd
+            for (int i = i0; i <= i1; ++i)
+            {
+                const double ua = 0.5 * (ub[i] + ut[i]), va = 0.5 * (vr[i - 1] + vr[i]);
+                go[i] = flux(va, ua, ub[i], ut[i], gamma);
+                ko[i] = flux(ua, va, vr[i - 1], vr[i], gamma);
+            }
+        }
+
+        // vv at the cell centres between v rows j and j + 1, for cells i0 .. i1 - 1
+        static void centres(const Field &v, int j, int i0, int i1, double gamma, std::vector<double> &hc)
+        {
+            const double * __restrict__ vb = row(v, j);
+            const double * __restrict__ vt = row(v, j + 1);
+            double * __restrict__ o = &hc[0];
+
+            #pragma omp simd
+            for (int i = i0; i < i1; ++i)
+            {
+                const double va = 0.5 * (vb[i] + vt[i]);
+                o[i] = flux(va, va, vb[i], vt[i], gamma);
+            }
+        }
+
+        // u faces max(i0, 1) .. i1 - 1 of row j (faces 0 and nx are the walls)
+        void uRow(const Field &u, Field &u_next, int j, int i0, int i1,
+                  double dt, double h, double nu, double gamma, Fluxes &f) const
+        {
+            const std::ptrdiff_t su = u.strideY();
+            const double * __restrict__ c = row(u, j);
+            double * __restrict__ o = u_next.data() + u_next.index(0, j, 0);
+            double * __restrict__ fx = &f.f_x[0];
+            const double * __restrict__ gb = &f.g_bot[0];
+            const double * __restrict__ gt = &f.g_top[0];
+            const double ih = 1.0 / h, k = nu / (h * h);
+
+            const int first = std::max(i0, 1), last = i1 - 1;
+
+            // uu at cells first - 1 .. last
+            #pragma omp simd
+            for (int cell = first - 1; cell <= last; ++cell)
+            {
+                const double ua = 0.5 * (c[cell] + c[cell + 1]);
+                fx[cell + 1] = flux(ua, ua, c[cell], c[cell + 1], gamma);
+            }
+
+            #pragma omp simd
+            for (int i = first; i <= last; ++i)
+            {
+                const double conv = (fx[i + 1] - fx[i] + gt[i] - gb[i]) * ih;
+                const double visc = k * (c[i + 1] + c[i - 1] + c[i + su] + c[i - su] - 4 * c[i]);
+                o[i] = c[i] + dt * (visc - conv);
+            }
+        }
+
+        // v cells i0 .. i1 - 1 of row j
+        void vRow(const Field &v, Field &v_next, int j, int i0, int i1,
+                  double dt, double h, double nu, Fluxes &f) const
+        {
+            const std::ptrdiff_t sv = v.strideY();
+            const double * __restrict__ c = row(v, j);
+            double * __restrict__ o = v_next.data() + v_next.index(0, j, 0);
+            const double * __restrict__ hb = &f.h_below[0];
+            const double * __restrict__ ha = &f.h_above[0];
+            const double * __restrict__ kc = &f.k_cur[0];
+            const double ih = 1.0 / h, k = nu / (h * h);
+
+            #pragma omp simd
+            for (int i = i0; i < i1; ++i)
+            {
+                const double conv = (ha[i] - hb[i] + kc[i + 1] - kc[i]) * ih;
+                const double visc = k * (c[i + 1] + c[i - 1] + c[i + sv] + c[i - sv] - 4 * c[i]);
+                o[i] = c[i] + dt * (visc - conv);
+            }
+        }
+};
+
+
+/* Backward Euler for the viscous terms, (I - nu dt lap) u_new = u for
+   both components, by approximate factorisation:
+
+       (I - a dxx) (I - a dyy) u_new = u,    a = nu dt / h^2
+
+   which differs from the full implicit step by O(dt^2), no more than
+   its own error. Each factor is a set of tridiagonal systems, one per
+   grid line, so the step costs O(N) and is stable for any dt. Along a
+   line ending on a wall the end values are fixed (identity rows); along
+   a line ending next to a wall the ghost is eliminated through
+   ghost = 2 U - edge, which changes the end of the diagonal to 1 + 3a
+   and puts 2 a U into the right hand side.
+
+   The lines in y are interleaved in memory (Field is x fastest), so
+   each thread solves its share of them in one solveBatch() call; the
+   lines in x are contiguous and are solved one by one.
+*/
+class ViscousSolver
+{
+    public:
+        ViscousSolver(int nx, int ny, const Walls &walls) : nx(nx), ny(ny), walls(walls), a(-1.0) {}
+
+        // rebuild the matrices for a = nu dt / h^2 (only if it changed)
+        void setFactor(double factor)
+        {
+            if (factor == a) return;
+            a = factor;
+
+            ux.reset(new TridiagonalSolver(line(nx + 1, true)));
+            uy.reset(new TridiagonalSolver(line(ny, false)));
+            vx.reset(new TridiagonalSolver(line(nx, false)));
+            vy.reset(new TridiagonalSolver(line(ny + 1, true)));
+        }
+
+        void solve(Field &u, Field &v) const
+        {
+            const std::ptrdiff_t su = u.strideY(), sv = v.strideY();
+
+            // x lines: u along rows 0 .. ny - 1 (wall ends), v along the
+            // interior rows 1 .. ny - 1 (ghost ends)
+            forEachRow(u, [&](int j, int)
+            {
+                ux->solve(&u(0, j), &u(0, j));
+            });
+            forEachRow(v, [&](int j, int)
+            {
+                if (j == 0 || j == ny) return;
+                double *r = &v(0, j);
+                r[0] += 2 * a * walls.left;
+                r[nx - 1] += 2 * a * walls.right;
+                vx->solve(r, r);
+            });
+
+            // y lines: u at the interior faces i = 1 .. nx - 1 (ghost
+            // ends), v at i = 0 .. nx - 1 (wall ends)
+            #pragma omp parallel
+            {
+                int lo, hi;
+                slabRange(nx - 1, lo, hi);
+                if (hi > lo)
+                {
+                    double *r = &u(1 + lo, 0);
+                    for (int i = 0; i < hi - lo; ++i)
+                    {
+                        r[i] += 2 * a * walls.bottom;
+                        r[i + (ny - 1) * su] += 2 * a * walls.top;
+                    }
+                    uy->solveBatch(r, r, hi - lo, int(su));
+                }
+
+                slabRange(nx, lo, hi);
+                if (hi > lo) vy->solveBatch(&v(lo, 0), &v(lo, 0), hi - lo, int(sv));
+            }
+        }
+
+    private:
+        int nx, ny;
+        Walls walls;
+        double a;
+        std::unique_ptr<TridiagonalSolver> ux, uy, vx, vy;
+
+        // (I - a d^2) along a line of n values
+        TridiagonalSolver line(int n, bool wall_ends) const
+        {
+            vector<double> l(n), d(n), r(n);
+
+            for (int i = 0; i < n; ++i)
+            {
+                l(i) = -a;
+                d(i) = 1 + 2*a;
+                r(i) = -a;
+            }
+
+            l(0) = r(n - 1) = 0.0;
+            if (wall_ends)
+            {
+                r(0) = l(n - 1) = 0.0;
+                d(0) = d(n - 1) = 1.0;
+            }
+            else
+            {
+                d(0) = d(n - 1) = 1 + 3*a;
+            }
+
+            return TridiagonalSolver(l, d, r, n);
+        }
+};
+
+
+// out = scale * div(u, v) at the cell centres
+inline void divergence(const Field &u, const Field &v, Field &out, double scale)
+{
+    const int nx = out.nx();
+    const std::ptrdiff_t sv = v.strideY();
+
+    forEachRow(out, [&](int j, int)
+    {
+        const double *cu = u.data() + u.index(0, j, 0), *cv = v.data() + v.index(0, j, 0);
+        double *o = &out(0, j);
+
+        #pragma omp simd
+        for (int i = 0; i < nx; ++i) o[i] = scale * (cu[i + 1] - cu[i] + cv[i + sv] - cv[i]);
+    });
+}
+
+
+/* What a step did to the velocity: the largest |u| and |v| after it,
+   which set the next timestep, and the largest change in either
+   component over the step, which shows how far the flow is from a
+   steady state.
+*/
+struct StepStats
+{
+    double u_max, v_max, change;
+};
+
+/* Subtract scale * grad(p) from the velocity at every face which isn't
+   on a wall, i.e. u -= dt grad(p) / h for scale = dt / h. This is the
+   last pass over the velocity in a step, so the StepStats are gathered
+   (as max reductions) in the same pass, against the velocity before the
+   step in u_old / v_old.
+*/
+inline StepStats subtractGradient(Field &u, Field &v, const Field &p, double scale,
+                                  const Field &u_old, const Field &v_old)
+{
+    const int nx = p.nx(), ny = p.ny();
+    const std::ptrdiff_t sp = p.strideY();
+    double u_max = 0.0, v_max = 0.0, change = 0.0;
+
+    #pragma omp parallel reduction(max: u_max, v_max, change)
+    {
+        int lo, hi;
+        slabRange(ny, lo, hi);
+
+        for (int j = lo; j < hi; ++j)
+        {
+            const double * __restrict__ c = p.data() + p.index(0, j, 0);
+
+            double * __restrict__ ou = &u(0, j);
+            const double * __restrict__ old_u = u_old.data() + u_old.index(0, j, 0);
+
+            #pragma omp simd reduction(max: u_max, change)
+            for (int i = 1; i < nx; ++i)
+            {
+                ou[i] -= scale * (c[i] - c[i - 1]);
+                u_max = std::max(u_max, std::fabs(ou[i]));
+                change = std::max(change, std::fabs(ou[i] - old_u[i]));
+            }
+
+            // v row 0 is the bottom wall
+            if (j == 0) continue;
+
+            double * __restrict__ ov = &v(0, j);
+            const double * __restrict__ old_v = v_old.data() + v_old.index(0, j, 0);
+
+            #pragma omp simd reduction(max: v_max, change)
+            for (int i = 0; i < nx; ++i)
+            {
+                ov[i] -= scale * (c[i] - c[i - sp]);
+                v_max = std::max(v_max, std::fabs(ov[i]));
+                change = std::max(change, std::fabs(ov[i] - old_v[i]));
+            }
+        }
+    }
+
+    StepStats stats = { u_max, v_max, change };
+    return stats;
+}
+
+
+/* Speed at the cell centres, averaging the two faces of each component,
+   and the total kinetic energy (per unit density) of the cells.
+*/
+inline double cellSpeed(const Field &u, const Field &v, Field &out, double h)
+{
+    double energy = 0.0;
+
+    for (int j = 0; j < out.ny(); ++j)
+        for (int i = 0; i < out.nx(); ++i)
+        {
+            double uc = 0.5 * (u(i, j) + u(i + 1, j)), vc = 0.5 * (v(i, j) + v(i, j + 1));
+            out(i, j) = std::sqrt(uc * uc + vc * vc);
+            energy += 0.5 * (uc * uc + vc * vc) * h * h;
+        }
+
+    return energy;
+}
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef POISSON_H
+#define POISSON_H
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "field.h"
+#include "fft.h"
+
+/* Direct solver for the Poisson equation lap(u) = f on a 2D cell
+   centred Field of nx x ny cells of width h, with the 5 point Laplacian
+   and a NEUMANN or DIRICHLET condition (as for applyBoundaries()) on
+   each pair of opposite faces; both faces of a direction must have the
+   same type, but a Dirichlet wall can have any value.
+
+   The cosine (Neumann) or sine (Dirichlet) transform in each direction
+   diagonalises the Laplacian, so the solve is a forward transform of f
+   in x and then y, a division by the eigenvalue of each mode, and the
+   inverse transforms back: O(N log N) in all, exact up to rounding,
+   whatever the right hand side. With Neumann walls on every face the
+   constant mode has eigenvalue zero; it is dropped, which solves for
+   the part of f with zero mean and leaves u with zero mean (as the
+   multigrid solver does).
+
+   The transform plans, the eigenvalues and the scratch space are all
+   built with the solver, so each solve only does the transforms. The x
+   transforms work along the rows of the field two at a time; the grid
+   is then transposed (in cache sized tiles) so that the y transforms
+   also run along contiguous rows, and the division and the inverse y
+   transforms are done in the same pass. Rows are shared between
+   threads with slabRange(), like the rest of the Field code.
+*/
+class SpectralPoisson
+{
+    public:
+        SpectralPoisson(int nx, int ny, double h, const Boundary bc[6])
+            : nx(nx), ny(ny), h(h), tile(32),
+              tx(nx, bc[X_LO].type == DIRICHLET), ty(ny, bc[Y_LO].type == DIRICHLET),
+              a(std::size_t(nx) * ny), b(std::size_t(nx) * ny)
+        {
+            std::copy(bc, bc + 6, bc_);
+
+            for (int i = 0; i < nx; ++i) ex.push_back(tx.eigenvalue(i) / (h * h));
+            for (int j = 0; j < ny; ++j) ey.push_back(ty.eigenvalue(j) / (h * h));
+
+#ifdef _OPENMP
+            int threads = omp_get_max_threads();
+#else
+            int threads = 1;
+#endif
+            for (int t = 0; t < threads; ++t)
+                scratch.push_back(std::unique_ptr<Scratch>(new Scratch(std::max(nx, ny))));
+        }
+
+        // u = the solution (interior only; the halo is left alone)
+        void solve(Field &u, const Field &f)
+        {
+            // x transforms of f, with the Dirichlet wall values moved to
+            // the right hand side, into a (row j at a[j nx])
+            const double wx_lo = wall(X_LO), wx_hi = wall(X_HI);
+            const double wy_lo = wall(Y_LO), wy_hi = wall(Y_HI);
+
+            pairs(ny, [&](int j, int m, Scratch &s)
+            {
+                for (int r = 0; r < m; ++r)
+                {
+                    const double *src = f.data() + f.index(0, j + r, 0);
+                    double *row = &a[std::size_t(j + r) * nx];
+                    std::copy(src, src + nx, row);
+
+                    row[0] -= wx_lo;
+                    row[nx - 1] -= wx_hi;
+                    if (j + r == 0) for (int i = 0; i < nx; ++i) row[i] -= wy_lo;
+                    if (j + r == ny - 1) for (int i = 0; i < nx; ++i) row[i] -= wy_hi;
+                }
+                tx.forward(&a[std::size_t(j) * nx], m == 2 ? &a[std::size_t(j + 1) * nx] : 0, s.z(), s.work());
+            });
+
+            transpose(&a[0], &b[0], ny, nx);
+
+            // y transforms along the rows of b (row i at b[i ny]), divide by
+            // the eigenvalues, and back again
+            const bool singular = (bc_[X_LO].type != DIRICHLET && bc_[Y_LO].type != DIRICHLET);
+
+            pairs(nx, [&](int i, int m, Scratch &s)
+            {
+                double *r0 = &b[std::size_t(i) * ny], *r1 = (m == 2) ? r0 + ny : 0;
+                ty.forward(r0, r1, s.z(), s.work());
+
+                for (int r = 0; r < m; ++r)
+                {
+                    double *row = r0 + std::size_t(r) * ny;
+                    const double e = ex[i + r];
+                    for (int j = 0; j < ny; ++j) row[j] /= (e + ey[j]);
+                    if (singular && i + r == 0) row[0] = 0.0;
+                }
+
+                ty.inverse(r0, r1, s.z(), s.work());
+            });
+
+            transpose(&b[0], &a[0], nx, ny);
+
+            // and the inverse x transforms, straight into u
+            pairs(ny, [&](int j, int m, Scratch &s)
+            {
+                double *r0 = &a[std::size_t(j) * nx];
+                tx.inverse(r0, m == 2 ? r0 + nx : 0, s.z(), s.work());
+
+                for (int r = 0; r < m; ++r)
+                    std::copy(r0 + std::size_t(r) * nx, r0 + std::size_t(r + 1) * nx, u.data() + u.index(0, j + r, 0));
+            });
+        }
+
+    private:
+        struct Scratch
+        {
+            explicit Scratch(int n) : buffer(2 * n) {}
+            Complex *z() { return &buffer[0]; }
+            Complex *work() { return &buffer[buffer.size() / 2]; }
+            std::vector<Complex> buffer;
+        };
+
+        int nx, ny;
+        double h;
+        int tile;
+        Boundary bc_[6];
+        RealTransform tx, ty;
+        std::vector<double> ex, ey;
+        std::vector<double> a, b;
+        std::vector<std::unique_ptr<Scratch> > scratch;
+
+        /* Contribution of a Dirichlet wall to the edge cells: the ghost is
+           2 value - edge, so lap(u) there has an extra 2 value / h^2,
+           which the homogeneous solve needs taken off f.
+        */
+        double wall(Face face) const
+        {
+            return bc_[face].type == DIRICHLET ? 2 * bc_[face].value / (h * h) : 0.0;
+        }
+
+        /* Call op(first, count, scratch) for the lines 0 .. n - 1 in pairs
+           (count = 2, or 1 for the last line when n is odd), shared
+           between threads.
+        */
+        template <class PairOp>
+        void pairs(int n, PairOp op)
+        {
+            #pragma omp parallel
+            {
+                int lo, hi;
+                slabRange((n + 1) / 2, lo, hi);
+#ifdef _OPENMP
+                Scratch &s = *scratch[omp_get_thread_num()];
+#else
+                Scratch &s = *scratch[0];
+#endif
+                for (int p = lo; p < hi; ++p)
+                    op(2 * p, std::min(2, n - 2 * p), s);
+            }
+        }
+
+        // out (cols x rows) = in (rows x cols) transposed, a tile at a time
+        void transpose(const double *in, double *out, int rows, int cols) const
+        {
+            const int blocks = (rows + tile - 1) / tile;
+
+            #pragma omp parallel
+            {
+                int lo, hi;
+                slabRange(blocks, lo, hi);
+
+                const int r_end = std::min(rows, hi * tile);
+                for (int rb = lo * tile; rb < r_end; rb += tile)
+                {
+                    const int r_hi = std::min(r_end, rb + tile);
+                    for (int cb = 0; cb < cols; cb += tile)
+                    {
+                        for (int c = cb; c < std::min(cols, cb + tile); ++c)
+                        {
+                            double * __restrict__ o = out + std::size_t(c) * rows;
+                            const double * __restrict__ column = in + c;
+                            for (int r = rb; r < r_hi; ++r) o[r] = column[std::size_t(r) * cols];
+                        }
+                    }
+                }
+            }
+        }
+};
+
+#endif
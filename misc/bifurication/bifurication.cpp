@@ -0,0 +1,103 @@
+/*
+   Bifurication diagram of the logistic map
+
+       x_n+1 = a * x_n * ( 1 - x_n )
+
+   as in bifurication.py: for every a (and several starting values x0,
+   as it may converge to more than one solution) iterate until x stops
+   changing, or give up after max_iterations, and plot where x ends up.
+
+   All the (a, x0) pairs are one ensemble (see ensemble.h), iterated a
+   block at a time with the pairs of a block in the lanes of SIMD
+   vectors, and the blocks shared between all the cores. Each pair is
+   masked off as soon as it has converged.
+*/
+#include <iostream>
+#include <fstream>
+#include <array>
+#include <omp.h>
+
+#include "map.h"
+#include "ensemble.h"
+
+using std::cout;
+using std::endl;
+
+// x, the previous x (to tell when it has converged) and a
+const int N = 3;
+
+struct Logistic
+{
+    template <class T>
+    void operator()(double, const std::array<T, N> &y, std::array<T, N> &next) const
+    {
+        next[0] = y[2] * y[0] * (1.0 - y[0]);
+        next[1] = y[0];
+        next[2] = y[2];
+    }
+};
+
+// converged (below zero) once |x_n+1 - x_n| < tolerance
+struct Converged
+{
+    double tolerance;
+
+    template <class T>
+    T operator()(double, const std::array<T, N> &y) const
+    {
+        const T d = y[0] - y[1];
+        return d * d - tolerance * tolerance;
+    }
+};
+
+int main (int, char **)
+{
+
+    double a_min = 2.0, a_max = 4.0, da = 0.001;    // set of a values to use
+    double x_min = 0.001, x_max = 1.0, dx = 0.01;   // and of starting values
+
+    double tolerance = 0.0001;
+    int max_iterations = 200;       // only bother checking for this many (may get stuck)
+
+    int n_a = int((a_max - a_min) / da + 0.5);
+    int n_x = int((x_max - x_min) / dx + 0.5);
+
+    Ensemble<N> ensemble(n_a * n_x);
+    for (int j = 0; j < n_x; ++j)
+        for (int i = 0; i < n_a; ++i)
+        {
+            const int m = j * n_a + i;
+            ensemble(m, 0) = x_min + j * dx;
+            ensemble(m, 1) = -1.0;          // not converged to begin with
+            ensemble(m, 2) = a_min + i * da;
+        }
+
+    cout << ensemble.size() << " starting points, " << omp_get_max_threads() << " threads, "
+         << int(Ensemble<N>::width) << " per SIMD block" << endl;
+
+
+    Logistic logistic;
+    Converged converged = { tolerance };
+
+    double start = omp_get_wtime();
+    long iterations = integrate<MapStepper>(ensemble, logistic, 0.0, max_iterations, 1.0, converged);
+    double elapsed = omp_get_wtime() - start;
+
+    int stuck = 0;
+    for (int m = 0; m < ensemble.size(); ++m)
+        if (ensemble.stopTime(m) > max_iterations) ++stuck;
+
+    cout << iterations << " iterations in " << elapsed << " s, "
+         << 1e9 * elapsed / iterations << " ns each" << endl;
+    cout << ensemble.size() - stuck << " converged, " << stuck << " still going after "
+         << max_iterations << " iterations" << endl;
+
+
+    // final values, against a
+    std::ofstream outputFile("data/output.dat");
+    outputFile << "# a\tx" << endl;
+    for (int m = 0; m < ensemble.size(); ++m)
+        outputFile << ensemble(m, 2) << "\t" << ensemble(m, 0) << endl;
+
+    return 0;
+}
@@ -0,0 +1,5 @@
+set title "bifurication diagram for: x_{n+1} = x_n a (1 - x_n)"
+set xlabel "parameter a"
+set ylabel "convergent value (x)"
+set key off
+plot "output.dat" using 1:2 with dots
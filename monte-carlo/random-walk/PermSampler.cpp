@@ -0,0 +1,110 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  PermSampler.cpp
+ *
+ *    Description:  Growth sampling of self-avoiding walks on a 2D lattice using
+ *                  Rosenbluth weights, optionally with pruning and enrichment (PERM)
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include "PermSampler.h"
+#include "helpers/rng.h"
+
+// connective constant of the square lattice, used to keep the weights
+// of order one (dividing every step by the same number doesn't change
+// any weighted averages at fixed length)
+static const double MU = 2.638;
+
+// walks above / below these multiples of the mean weight at
+// their length are enriched / pruned
+static const double ENRICH = 3.0;
+static const double PRUNE = 1.0 / 3.0;
+
+static const int STEP_X[4] = {0, 1, 0, -1};
+static const int STEP_Y[4] = {1, 0, -1, 0};
+
+
+PermSampler::PermSampler(int maxLength, unsigned int seed, bool prune) :
+    maxLength_(maxLength), prune_(prune),
+    xs(maxLength + 1), ys(maxLength + 1), weight(maxLength + 1), copies(maxLength + 1),
+    Z(maxLength + 1), tours_(0), occupied(maxLength + 1) {
+
+    gen.seed(seed);
+}
+
+
+// Rather than recursing (which would need a stack frame per step for
+// walks of 10^5 steps) the tour is a depth first search over an explicit
+// stack: copies[n] counts how many more times we still have to try to
+// grow the walk from length n before backing up to length n - 1.
+void PermSampler::runTour(WalkStats &stats) {
+
+    ++tours_;
+
+    // map each length onto its checkpoint (if any)
+    std::vector<int> checkpointOf(maxLength_ + 1, -1);
+    for (int c = 0; c < stats.size(); ++c)
+        if (stats.checkpoint(c) <= maxLength_) checkpointOf[stats.checkpoint(c)] = c;
+
+    int n = 0;
+    xs[0] = ys[0] = 0;
+    weight[0] = 1.0;
+    copies[0] = 1;
+    occupied.clear();
+    occupied.insert(0, 0, 0);
+
+    while (true) {
+
+        // nothing left to do at this length so back up one step
+        if (copies[n] == 0) {
+            if (n == 0) break;
+            occupied.erase(xs[n], ys[n]);
+            --n;
+            continue;
+        }
+
+        --copies[n];
+
+        // find the free neighbours of the end of the walk
+        int free[4], k = 0;
+        for (int d = 0; d < 4; ++d)
+            if (occupied.find(xs[n] + STEP_X[d], ys[n] + STEP_Y[d]) < 0) free[k++] = d;
+
+        if (k == 0) continue;       // trapped
+
+        int d = free[scaleRandom(gen(), k)];
+        double w = weight[n] * k / MU;
+
+        ++n;
+        xs[n] = xs[n - 1] + STEP_X[d];
+        ys[n] = ys[n - 1] + STEP_Y[d];
+        occupied.insert(xs[n], ys[n], n);
+
+        Z[n] += w;
+        if (checkpointOf[n] >= 0) stats.addWalk(checkpointOf[n], xs[n], ys[n], w);
+
+        // decide how many times to carry on from here
+        copies[n] = 1;
+
+        if (prune_) {
+            double mean = Z[n] / tours_;
+
+            if (w > ENRICH * mean) {
+                copies[n] = 2;
+                w *= 0.5;
+            }
+            else if (w < PRUNE * mean) {
+                if (unitRandom(gen()) < 0.5) copies[n] = 0;
+                else w *= 2.0;
+            }
+        }
+
+        if (n == maxLength_) copies[n] = 0;
+        weight[n] = w;
+    }
+}
@@ -0,0 +1,56 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  PermSampler.h
+ *
+ *    Description:  Growth sampling of self-avoiding walks on a 2D lattice using
+ *                  Rosenbluth weights, optionally with pruning and enrichment (PERM)
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+
+#ifndef  PERMSAMPLER_INC
+#define  PERMSAMPLER_INC
+
+#include <vector>
+
+#include <boost/random/mersenne_twister.hpp>
+
+#include "WalkStats.h"
+#include "helpers/SiteHashSet.h"
+
+class PermSampler {
+    public:
+        // grows walks of up to maxLength steps, with prune = false
+        // giving plain Rosenbluth sampling
+        PermSampler(int maxLength, unsigned int seed, bool prune = true);
+
+        // grow one tour from the origin, adding the weighted end-to-end
+        // vectors of every walk which reaches a checkpoint length
+        void runTour(WalkStats &stats);
+
+        long tours() const { return tours_; }
+
+    private:
+        int maxLength_;
+        bool prune_;
+
+        // current walk (as a stack, so branches can be undone)
+        std::vector<int> xs, ys;
+        std::vector<double> weight;     // Rosenbluth weight of each partial walk
+        std::vector<int> copies;        // continuations still to grow from each length
+
+        // sum of weights at each length over every tour so far,
+        // used to set the pruning / enrichment thresholds
+        std::vector<double> Z;
+        long tours_;
+
+        SiteHashSet occupied;
+        boost::mt19937 gen;
+};
+
+#endif   /* ----- #ifndef PERMSAMPLER_INC  ----- */
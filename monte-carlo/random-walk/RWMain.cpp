@@ -11,10 +11,22 @@
  *
  * =====================================================================================
  */
-#include "Walker.h"
+#include "WalkerBatch.h"
+#include "SAWalker.h"
+#include "PermSampler.h"
+#include "WalkStats.h"
+#include "WalkEnsemble.h"
+#include "Trajectory.h"
 
 
 #include <cmath>
+#include <cstdlib>
+#include <ctime>        // for seeding RNG
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
 #include <iostream>     // for debugging / output
 #include <fstream>      // for writing data to file
 
@@ -27,56 +39,165 @@ int main (int argc, char **argv) {
 
     // basic experiment settings
     int experiments = 1000;   // how many random walks to test
-    int N = 20;             // how many steps to take
-    // quantities to average
-    double endToEndSum = 0.0, endToEndMean = 0.0;
-    double xSum = 0.0, xMean = 0.0;
-    double ySum = 0.0, yMean = 0.0;
 
-    // may as well resuse one random walker
-    // rather than re-initialising every time
-    Walker rw;
+    // walk lengths to measure at
+    std::vector<int> checkpoints;
+    for (int N = 10; N < 5000; N += 40) checkpoints.push_back(N);
+
+    // which kind of walk to sample:
+    //   NONREVERSING - walks which can't retrace the step they just took
+    //   PIVOT        - true self-avoiding walks, sampled by pivot moves
+    //   PERM         - true self-avoiding walks, grown with Rosenbluth
+    //                  weights and pruning / enrichment
+    enum WalkType { NONREVERSING, PIVOT, PERM };
+    int walkType = NONREVERSING;
+
+    // SINGLE_PASS grows every walk once up to the longest length and
+    // records the averages as it passes each checkpoint, RESTART runs
+    // fresh walks for every length (so the points are uncorrelated)
+    enum Sampling { SINGLE_PASS, RESTART };
+    int sampling = SINGLE_PASS;
+
+    // optionally keep every step of the (NONREVERSING) walks, as they
+    // are at the end of the run, in a compact binary file
+    bool recordTrajectories = false;
+    bool compressTrajectories = true;
+    std::string trajectoryFile = "data/walks.rwt";
+
+    // pivot attempts to reach equilibrium (per step of the walk)
+    // and between measurements
+    long pivotWarmup = 20, pivotInterval = 10;
+
+    // the experiments are split into independent shards, each with its
+    // own random number stream, which are shared out between threads
+    int shardSize = 250;        // walkers per shard (NONREVERSING) / tours per shard (PERM)
+    int threads = std::thread::hardware_concurrency();
+
+    // the same seed gives the same output whatever the number of threads,
+    // usage: ./RandomWalk [seed] [threads]
+    unsigned int seed = static_cast<unsigned int>(std::time(0));
+    if (argc > 1) seed = static_cast<unsigned int>(std::strtoul(argv[1], 0, 10));
+    if (argc > 2) threads = std::atoi(argv[2]);
+
+    cout << "seed: " << seed << ", threads: " << threads << endl;
+
+    int shards = (experiments + shardSize - 1) / shardSize;
+    ShardJob job;
+
+    // each shard is written as one chunk of the trajectory file
+    std::unique_ptr<TrajectoryWriter> trajectories;
+    if (recordTrajectories && walkType == NONREVERSING)
+        trajectories.reset(new TrajectoryWriter(trajectoryFile, shardSize, compressTrajectories));
+
+    switch(walkType) {
+        case NONREVERSING:
+
+            // every experiment in the shard is one walker in the
+            // batch, so all of its walks are done together
+            job = [&](int shard, unsigned int shardSeed, WalkStats &stats) {
+
+                int walks = std::min(shardSize, experiments - shard * shardSize);
+                WalkerBatch walkers(walks, shardSeed);
+
+                if (trajectories) {
+                    walkers.recordMoves(true);
+                    walkers.reset();
+                }
+
+                for (int c = 0; c < stats.size(); ++c) {
+
+                    if (sampling == RESTART) walkers.reset();
+
+                    // perform (or continue) the walks up to N random steps
+                    walkers.extendTo(stats.checkpoint(c));
+
+                    for (int n = 0; n < walks; n++)
+                        stats.addWalk(c, walkers.x(n), walkers.y(n));
+                }
+
+                if (trajectories) {
+                    std::vector<std::vector<boost::uint8_t> > packed(walks);
+                    std::vector<boost::uint64_t> steps(walks, walkers.steps());
+
+                    for (int n = 0; n < walks; n++) walkers.packedMoves(n, packed[n]);
+                    trajectories->writeChunk(shard, packed, steps);
+                }
+            };
+            break;
+
+        case PIVOT:
+
+            // the pivot algorithm works at fixed length, so
+            // each checkpoint is a separate shard
+            shards = checkpoints.size();
+
+            job = [&](int c, unsigned int shardSeed, WalkStats &stats) {
+
+                int N = stats.checkpoint(c);
+                SAWalker saw(N, shardSeed);
+
+                saw.pivot(pivotWarmup * N);
+
+                for (int n = 0; n < experiments; n++) {
+                    saw.pivot(pivotInterval);
+                    stats.addWalk(c, saw.x(), saw.y());
+                }
+            };
+            break;
+
+        case PERM:
+
+            // each tour contributes (weighted) walks at every length
+            job = [&](int shard, unsigned int shardSeed, WalkStats &stats) {
+
+                int tours = std::min(shardSize, experiments - shard * shardSize);
+                PermSampler perm(checkpoints.back(), shardSeed);
+
+                for (int n = 0; n < tours; n++) perm.runTour(stats);
+            };
+            break;
+    }
+
+    // quantities to average
+    WalkStats stats = runEnsemble(checkpoints, shards, threads, seed, job);
 
 
     std::ofstream dataFile;                     // output data to file
     dataFile.open("data/output.dat", std::ios::trunc);    // overwrite existing data
     dataFile << "# N - number of steps in the walk" << endl;
     dataFile << "# <R> - mean end-to-end distance" << endl;
-    dataFile << "# N \t <R> \t sqrt(N)" << endl;
+    dataFile << "# N \t <R> \t sqrt(N) \t <R^2> \t <|x|> \t <|y|>" << endl;
 
-    // loop for a different length of walker
-    for (N = 10; N < 5000; N += 40) {
+    for (int c = 0; c < stats.size(); ++c) {
 
-        // reset averages etc
-        endToEndSum = endToEndMean = 0.0;
-        xSum = xMean = 0.0;
-        ySum = yMean = 0.0;
+        int N = stats.checkpoint(c);
 
-        // each loop is one complete walk
-        for (int n = 0; n < experiments; n++) {
+        // write to file
+        dataFile << N << "\t" << stats.meanR(c) << "\t\t" << sqrt(N) << "\t\t"
+                 << stats.meanR2(c) << "\t\t" << stats.meanAbsX(c) << "\t\t" << stats.meanAbsY(c) << endl;
+    }
 
-            // reset the random walker to position (0, 0)
-            rw.reset();
 
-            // perform N random steps
-            rw.performWalk(N);
+    dataFile.close();       // close the file
 
-            endToEndSum += rw.endToEndDist();
-            xSum += abs(rw.x());
-            ySum += abs(rw.y());
-        }
 
-        endToEndMean = endToEndSum / (double) experiments;  // calculate the mean
-        xMean = xSum / (double) experiments;
-        yMean = ySum / (double) experiments;
+    // a quick look back through the saved walks
+    if (trajectories) {
 
-        // write to file
-        dataFile << N << "\t" << endToEndMean << "\t\t" << sqrt(N) << endl;                     // <R>
-        //dataFile << N << "\t" << endToEndMean*endToEndMean << "\t\t" << N << endl;            // <R>^2
-        //dataFile << N << "\t" << xMean*xMean << "\t\t" << yMean*yMean << "\t\t" << endl;      // <x> and <y>
-    }
+        trajectories->close();
 
+        TrajectoryReader reader(trajectoryFile);
+        double rg = 0.0, returns = 0.0;
+
+        for (boost::uint64_t k = 0; k < reader.walks(); ++k) {
+            rg += reader.radiusOfGyration(k);
+            returns += reader.returnsToOrigin(k);
+        }
+
+        if (!reader.good()) cout << "unable to read back " << trajectoryFile << endl;
+        cout << reader.walks() << " walks saved to " << trajectoryFile << endl;
+        cout << "<R_g> = " << rg / reader.walks() << ", mean returns to origin = " << returns / reader.walks() << endl;
+    }
 
-    dataFile.close();       // close the file
     return 0;
 }
@@ -0,0 +1,121 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  SAWalker.cpp
+ *
+ *    Description:  Self-avoiding walk of fixed length on a 2D lattice, sampled with
+ *                  the pivot algorithm
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include "SAWalker.h"
+#include "helpers/rng.h"
+#include <cmath>
+
+
+// The seven non-trivial symmetries of the square lattice, stored as
+// the matrix (a b; c d) acting on (dx, dy): three rotations and four
+// reflections.
+static const int SYMMETRIES[7][4] = {
+    { 0, -1,  1,  0},       // rotate by 90
+    {-1,  0,  0, -1},       // rotate by 180
+    { 0,  1, -1,  0},       // rotate by 270
+    { 1,  0,  0, -1},       // reflect in x axis
+    {-1,  0,  0,  1},       // reflect in y axis
+    { 0,  1,  1,  0},       // reflect in y = x
+    { 0, -1, -1,  0}        // reflect in y = -x
+};
+
+
+SAWalker::SAWalker(int N, unsigned int seed) :
+    N_(N), xs(N + 1), ys(N + 1), newX(N + 1), newY(N + 1), occupied(N + 1) {
+
+    gen.seed(seed);
+    reset();
+}
+
+
+void SAWalker::reset() {
+
+    occupied.clear();
+
+    for (int i = 0; i <= N_; ++i) {
+        xs[i] = i;
+        ys[i] = 0;
+        occupied.insert(xs[i], ys[i], i);
+    }
+
+    attempts_ = accepted_ = 0;
+}
+
+
+// A pivot move picks a site k along the walk and applies a random
+// lattice symmetry to one side of the walk about that site. Only the
+// shorter side is moved (the two choices are equivalent up to a global
+// symmetry, which leaves R unchanged). Most rejections come from sites
+// close to the pivot, so the new positions are checked working outwards
+// and we give up at the first one which lands on the fixed part.
+bool SAWalker::attemptPivot() {
+
+    ++attempts_;
+
+    if (N_ < 2) return false;
+
+    int k = 1 + scaleRandom(gen(), N_ - 1);        // pivot site on [1, N - 1]
+    const int *g = SYMMETRIES[scaleRandom(gen(), 7)];
+
+    // sites first..last (inclusive) are moved, stepping away from k
+    bool moveTail = (k >= N_ / 2);
+    int first = moveTail ? k + 1 : k - 1;
+    int last = moveTail ? N_ : 0;
+    int dir = moveTail ? 1 : -1;
+
+    int px = xs[k], py = ys[k];
+
+    for (int i = first; i != last + dir; i += dir) {
+
+        int dx = xs[i] - px, dy = ys[i] - py;
+        int nx = px + g[0] * dx + g[1] * dy;
+        int ny = py + g[2] * dx + g[3] * dy;
+
+        // a clash with a site which is also being moved doesn't count,
+        // as that site will have moved out of the way
+        int j = occupied.find(nx, ny);
+        if (j >= 0 && (moveTail ? j <= k : j >= k)) return false;
+
+        newX[i] = nx;
+        newY[i] = ny;
+    }
+
+    // accepted, so update the occupied sites
+    for (int i = first; i != last + dir; i += dir) occupied.erase(xs[i], ys[i]);
+
+    for (int i = first; i != last + dir; i += dir) {
+        xs[i] = newX[i];
+        ys[i] = newY[i];
+        occupied.insert(xs[i], ys[i], i);
+    }
+
+    ++accepted_;
+    return true;
+}
+
+
+// returns R = sqrt(x^2 + y^2)
+double SAWalker::endToEndDist() const {
+    double dx = x(), dy = y();
+    return sqrt(dx * dx + dy * dy);
+}
+
+
+// override output operator for easier debugging
+std::ostream& operator<<(std::ostream& os, const SAWalker& walker) {
+
+    for (int i = 0; i <= walker.length(); ++i)
+        os << "(" << walker.xs[i] << ", " << walker.ys[i] << ")";
+    return os;
+}
@@ -0,0 +1,66 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  SAWalker.h
+ *
+ *    Description:  Self-avoiding walk of fixed length on a 2D lattice, sampled with
+ *                  the pivot algorithm
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+
+#ifndef  SAWALKER_INC
+#define  SAWALKER_INC
+
+#include <iostream>
+#include <vector>
+
+#include <boost/random/mersenne_twister.hpp>
+
+#include "helpers/SiteHashSet.h"
+
+class SAWalker {
+    public:
+        SAWalker(int N, unsigned int seed);     // walk of N steps
+
+        // restart from a straight rod along the x axis
+        void reset();
+
+        // try one pivot move, returning true if it was accepted
+        bool attemptPivot();
+
+        // perform a number of pivot attempts
+        void pivot(long attempts) { for (long n = 0; n < attempts; ++n) attemptPivot(); }
+
+        // find R
+        double endToEndDist() const;
+
+        // end-to-end vector (the walk starts wherever the pivots left it)
+        int x() const { return xs[N_] - xs[0]; }
+        int y() const { return ys[N_] - ys[0]; }
+
+        int length() const { return N_; }
+        double acceptance() const { return attempts_ ? double(accepted_) / attempts_ : 0.0; }
+
+        // override output operator
+        friend std::ostream& operator<<(std::ostream& os, const SAWalker& walker);
+
+    private:
+        int N_;
+
+        // positions of all N + 1 sites along the walk
+        std::vector<int> xs, ys;
+        // new positions of the sites being pivoted
+        std::vector<int> newX, newY;
+
+        SiteHashSet occupied;
+        boost::mt19937 gen;
+
+        long attempts_, accepted_;
+};
+
+#endif   /* ----- #ifndef SAWALKER_INC  ----- */
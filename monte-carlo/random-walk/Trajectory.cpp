@@ -0,0 +1,357 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Trajectory.cpp
+ *
+ *    Description:  Compact binary storage of complete walks, two bits per step, in
+ *                  (optionally compressed) chunks with an index for random access
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include "Trajectory.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include <zlib.h>       // chunk compression
+#include <fcntl.h>      // mmap etc. for the reader
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::cout;
+using std::endl;
+
+static const char HEADER_MAGIC[] = "RWTRAJ01";
+static const char FOOTER_MAGIC[] = "RWINDEX1";
+
+static const int STEP_X[4] = {0, 1, 0, -1};
+static const int STEP_Y[4] = {1, 0, -1, 0};
+
+
+// integers are always stored little endian, whatever the machine
+static void put32(std::vector<boost::uint8_t> &buf, boost::uint32_t v) {
+    for (int b = 0; b < 4; ++b) buf.push_back((v >> (8 * b)) & 0xff);
+}
+
+static void put64(std::vector<boost::uint8_t> &buf, boost::uint64_t v) {
+    for (int b = 0; b < 8; ++b) buf.push_back((v >> (8 * b)) & 0xff);
+}
+
+static boost::uint64_t get64(const boost::uint8_t *p) {
+    boost::uint64_t v = 0;
+    for (int b = 7; b >= 0; --b) v = (v << 8) | p[b];
+    return v;
+}
+
+static boost::uint32_t get32(const boost::uint8_t *p) {
+    return boost::uint32_t(p[0]) | (boost::uint32_t(p[1]) << 8)
+         | (boost::uint32_t(p[2]) << 16) | (boost::uint32_t(p[3]) << 24);
+}
+
+
+TrajectoryWriter::TrajectoryWriter(const std::string &filename, int walksPerChunk, bool compress) :
+    walksPerChunk_(walksPerChunk), compress_(compress), fileOffset(0) {
+
+    file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        cout << "unable to open " << filename << " for writing" << endl;
+        return;
+    }
+
+    std::vector<boost::uint8_t> header(HEADER_MAGIC, HEADER_MAGIC + 8);
+    put32(header, walksPerChunk);
+    put32(header, 0);
+
+    std::fwrite(&header[0], 1, header.size(), file);
+    fileOffset = header.size();
+}
+
+
+void TrajectoryWriter::writeChunk(int chunk, const std::vector<std::vector<boost::uint8_t> > &walks,
+                                  const std::vector<boost::uint64_t> &steps) {
+
+    if (!file) return;
+
+    ChunkEntry entry;
+
+    // lay the walks out one after another
+    std::vector<boost::uint8_t> raw;
+    for (size_t k = 0; k < walks.size(); ++k) {
+        entry.walkOffsets.push_back(raw.size());
+        entry.walkSteps.push_back(steps[k]);
+        raw.insert(raw.end(), walks[k].begin(), walks[k].end());
+    }
+
+    // compress outside the lock, keeping the raw bytes
+    // if compression doesn't actually help
+    std::vector<boost::uint8_t> packed;
+    entry.compressed = 0;
+
+    if (compress_ && !raw.empty()) {
+        uLongf bytes = compressBound(raw.size());
+        packed.resize(bytes);
+
+        if (compress2(&packed[0], &bytes, &raw[0], raw.size(), Z_DEFAULT_COMPRESSION) == Z_OK
+            && bytes < raw.size()) {
+            packed.resize(bytes);
+            entry.compressed = 1;
+        }
+    }
+
+    const std::vector<boost::uint8_t> &stored = entry.compressed ? packed : raw;
+    entry.rawBytes = raw.size();
+    entry.storedBytes = stored.size();
+
+    std::lock_guard<std::mutex> lock(fileMutex);
+
+    entry.offset = fileOffset;
+    if (!stored.empty()) std::fwrite(&stored[0], 1, stored.size(), file);
+    fileOffset += stored.size();
+
+    if (chunk >= int(chunks.size())) {
+        chunks.resize(chunk + 1);
+        written.resize(chunk + 1, false);
+    }
+    chunks[chunk] = entry;
+    written[chunk] = true;
+}
+
+
+void TrajectoryWriter::close() {
+
+    if (!file) return;
+
+    // walks are numbered by chunk, so there mustn't be any gaps
+    size_t nChunks = 0, nWalks = 0;
+    while (nChunks < chunks.size() && written[nChunks]) nWalks += chunks[nChunks++].walkSteps.size();
+
+    if (nChunks < chunks.size())
+        cout << "warning: trajectory chunk " << nChunks << " missing, later walks dropped" << endl;
+
+    std::vector<boost::uint8_t> index;
+    put64(index, nWalks);
+    put64(index, nChunks);
+
+    for (size_t c = 0; c < nChunks; ++c) {
+        put64(index, chunks[c].offset);
+        put64(index, chunks[c].storedBytes);
+        put64(index, chunks[c].rawBytes);
+        put64(index, chunks[c].compressed);
+    }
+
+    for (size_t c = 0; c < nChunks; ++c) {
+        for (size_t k = 0; k < chunks[c].walkSteps.size(); ++k) {
+            put64(index, chunks[c].walkOffsets[k]);
+            put64(index, chunks[c].walkSteps[k]);
+        }
+    }
+
+    put64(index, fileOffset);
+    index.insert(index.end(), FOOTER_MAGIC, FOOTER_MAGIC + 8);
+
+    std::fwrite(&index[0], 1, index.size(), file);
+    std::fclose(file);
+    file = 0;
+}
+
+
+TrajectoryReader::TrajectoryReader(const std::string &filename) :
+    data(0), size(0), damaged(false), walksPerChunk(0), cachedChunk(-1) {
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cout << "unable to open " << filename << endl;
+        return;
+    }
+
+    struct stat info;
+    fstat(fd, &info);
+    size = info.st_size;
+
+    void *mapped = (size >= 32) ? mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+
+    if (mapped == MAP_FAILED
+        || std::memcmp(mapped, HEADER_MAGIC, 8) != 0
+        || std::memcmp((const char *) mapped + size - 8, FOOTER_MAGIC, 8) != 0) {
+        cout << filename << " is not a trajectory file" << endl;
+        if (mapped != MAP_FAILED) munmap(mapped, size);
+        return;
+    }
+
+    data = static_cast<const boost::uint8_t *>(mapped);
+    walksPerChunk = get32(data + 8);
+
+    // read the index back in, checking every offset and count against
+    // the size of the file so a damaged one can't send us past its end
+    // (the data sits between the 16 byte header and the index, the index
+    // before the 16 byte footer)
+    boost::uint64_t indexOffset = get64(data + size - 16);
+    if (walksPerChunk <= 0 || indexOffset < 16 || indexOffset + 16 > size - 16) {
+        damagedFile(filename);
+        return;
+    }
+
+    const boost::uint8_t *p = data + indexOffset;
+    boost::uint64_t nWalks = get64(p), nChunks = get64(p + 8);
+    p += 16;
+
+    boost::uint64_t room = size - 16 - indexOffset - 16;
+    if (nChunks > room / 32 || nWalks > (room - 32 * nChunks) / 16
+        || nChunks != (nWalks + walksPerChunk - 1) / walksPerChunk) {
+        damagedFile(filename);
+        return;
+    }
+
+    for (boost::uint64_t c = 0; c < nChunks; ++c, p += 32) {
+        chunkOffset.push_back(get64(p));
+        chunkStored.push_back(get64(p + 8));
+        chunkRaw.push_back(get64(p + 16));
+        chunkCompressed.push_back(get64(p + 24));
+
+        // the stored bytes must lie between the header and the index,
+        // and a raw chunk is stored as it is
+        if (chunkOffset[c] < 16 || chunkOffset[c] > indexOffset
+            || chunkStored[c] > indexOffset - chunkOffset[c]
+            || (!chunkCompressed[c] && chunkRaw[c] != chunkStored[c])) {
+            damagedFile(filename);
+            return;
+        }
+    }
+
+    for (boost::uint64_t k = 0; k < nWalks; ++k, p += 16) {
+        walkOffset.push_back(get64(p));
+        walkSteps.push_back(get64(p + 8));
+
+        // the packed moves (four to a byte) must fit in the walk's chunk
+        boost::uint64_t c = k / walksPerChunk;
+        boost::uint64_t bytes = walkSteps[k] / 4 + (walkSteps[k] % 4 != 0);
+        if (walkOffset[k] > chunkRaw[c] || bytes > chunkRaw[c] - walkOffset[k]) {
+            damagedFile(filename);
+            return;
+        }
+    }
+}
+
+
+// give up on a file whose index doesn't make sense
+void TrajectoryReader::damagedFile(const std::string &filename) {
+
+    cout << filename << " is damaged" << endl;
+
+    munmap(const_cast<boost::uint8_t *>(data), size);
+    data = 0;
+    chunkOffset.clear(); chunkStored.clear(); chunkRaw.clear(); chunkCompressed.clear();
+    walkOffset.clear(); walkSteps.clear();
+}
+
+
+TrajectoryReader::~TrajectoryReader() {
+    if (data) munmap(const_cast<boost::uint8_t *>(data), size);
+}
+
+
+// raw chunks are read straight out of the mapped file, compressed
+// ones are inflated (and kept until a walk in another chunk is needed);
+// returns 0 for a walk that isn't there or a chunk that won't inflate
+const boost::uint8_t *TrajectoryReader::walkData(boost::uint64_t k) {
+
+    if (!data || k >= walkSteps.size()) return 0;
+
+    long c = k / walksPerChunk;
+
+    if (!chunkCompressed[c]) return data + chunkOffset[c] + walkOffset[k];
+
+    if (c != cachedChunk) {
+        cache.resize(chunkRaw[c]);
+        uLongf bytes = chunkRaw[c];
+        if (uncompress(&cache[0], &bytes, data + chunkOffset[c], chunkStored[c]) != Z_OK
+            || bytes != chunkRaw[c]) {
+            if (!damaged) cout << "chunk " << c << " is damaged" << endl;
+            damaged = true;
+            cachedChunk = -1;
+            return 0;
+        }
+        cachedChunk = c;
+    }
+
+    return &cache[0] + walkOffset[k];
+}
+
+
+bool TrajectoryReader::moves(boost::uint64_t k, std::vector<int> &out) {
+
+    const boost::uint8_t *packed = walkData(k);
+    if (!packed) {
+        out.clear();
+        return false;
+    }
+    boost::uint64_t n = walkSteps[k];
+
+    out.resize(n);
+    for (boost::uint64_t s = 0; s < n; ++s) out[s] = (packed[s / 4] >> (2 * (s % 4))) & 3;
+    return true;
+}
+
+
+bool TrajectoryReader::positions(boost::uint64_t k, std::vector<int> &xs, std::vector<int> &ys) {
+
+    const boost::uint8_t *packed = walkData(k);
+    if (!packed) {
+        xs.clear();
+        ys.clear();
+        return false;
+    }
+    boost::uint64_t n = walkSteps[k];
+
+    xs.resize(n + 1);
+    ys.resize(n + 1);
+    xs[0] = ys[0] = 0;
+
+    for (boost::uint64_t s = 0; s < n; ++s) {
+        int move = (packed[s / 4] >> (2 * (s % 4))) & 3;
+        xs[s + 1] = xs[s] + STEP_X[move];
+        ys[s + 1] = ys[s] + STEP_Y[move];
+    }
+    return true;
+}
+
+
+// R_g^2 = <(r - <r>)^2> over all the sites visited
+double TrajectoryReader::radiusOfGyration(boost::uint64_t k) {
+
+    std::vector<int> xs, ys;
+    if (!positions(k, xs, ys)) return 0.0;
+
+    double xMean = 0.0, yMean = 0.0, r2Mean = 0.0;
+    for (size_t i = 0; i < xs.size(); ++i) {
+        xMean += xs[i];
+        yMean += ys[i];
+        r2Mean += double(xs[i]) * xs[i] + double(ys[i]) * ys[i];
+    }
+
+    double n = xs.size();
+    xMean /= n; yMean /= n; r2Mean /= n;
+
+    return sqrt(r2Mean - xMean * xMean - yMean * yMean);
+}
+
+
+// number of times the walk comes back to where it started
+long TrajectoryReader::returnsToOrigin(boost::uint64_t k) {
+
+    std::vector<int> xs, ys;
+    positions(k, xs, ys);
+
+    long returns = 0;
+    for (size_t i = 1; i < xs.size(); ++i)
+        if (xs[i] == 0 && ys[i] == 0) ++returns;
+
+    return returns;
+}
@@ -0,0 +1,114 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Trajectory.h
+ *
+ *    Description:  Compact binary storage of complete walks, two bits per step, in
+ *                  (optionally compressed) chunks with an index for random access
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+
+#ifndef  TRAJECTORY_INC
+#define  TRAJECTORY_INC
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+/* File layout (all integers little endian):
+
+       header   "RWTRAJ01", uint32 walksPerChunk, uint32 reserved
+       chunks   one after another, each either raw or zlib compressed
+       index    uint64 walks, uint64 chunks
+                per chunk: uint64 offset, uint64 storedBytes, uint64 rawBytes, uint64 compressed
+                per walk:  uint64 offset (bytes, within its chunk), uint64 steps
+       footer   uint64 offset of the index, "RWINDEX1"
+
+   Walk k lives in chunk k / walksPerChunk. Within a chunk each walk
+   starts on a byte boundary and step s of the walk is stored in bits
+   2(s % 4) and 2(s % 4) + 1 of byte s / 4, using the same move numbers
+   as Walker (UP = 0, RIGHT = 1, DOWN = 2, LEFT = 3).
+*/
+
+class TrajectoryWriter {
+    public:
+        TrajectoryWriter(const std::string &filename, int walksPerChunk, bool compress);
+        ~TrajectoryWriter() { close(); }
+
+        // Write chunk number "chunk" (i.e. walks chunk * walksPerChunk
+        // onwards), given as the packed steps of each walk. Chunks can
+        // arrive in any order and from several threads at once.
+        void writeChunk(int chunk, const std::vector<std::vector<boost::uint8_t> > &walks,
+                        const std::vector<boost::uint64_t> &steps);
+
+        // write the index, after which no more chunks can be added
+        void close();
+
+        bool good() const { return file != 0; }
+
+    private:
+        struct ChunkEntry {
+            boost::uint64_t offset, storedBytes, rawBytes, compressed;
+            std::vector<boost::uint64_t> walkOffsets, walkSteps;
+        };
+
+        std::FILE *file;
+        int walksPerChunk_;
+        bool compress_;
+
+        std::vector<ChunkEntry> chunks;     // indexed by chunk number
+        std::vector<bool> written;
+        boost::uint64_t fileOffset;
+
+        std::mutex fileMutex;
+};
+
+
+class TrajectoryReader {
+    public:
+        // maps the whole file into memory
+        explicit TrajectoryReader(const std::string &filename);
+        ~TrajectoryReader();
+
+        // false if the file couldn't be read, or a chunk of it turned out damaged
+        bool good() const { return data != 0 && !damaged; }
+        boost::uint64_t walks() const { return walkSteps.size(); }
+        boost::uint64_t steps(boost::uint64_t k) const { return walkSteps[k]; }
+
+        // decode walk k into its moves (0 - 3); false (and no moves) if
+        // there is no walk k or it can't be read
+        bool moves(boost::uint64_t k, std::vector<int> &out);
+
+        // decode walk k into the positions visited, starting from (0, 0)
+        // (so there is one more position than there are steps); false as for moves()
+        bool positions(boost::uint64_t k, std::vector<int> &xs, std::vector<int> &ys);
+
+        // some simple measurements of walk k
+        double radiusOfGyration(boost::uint64_t k);
+        long returnsToOrigin(boost::uint64_t k);
+
+    private:
+        const boost::uint8_t *data;     // the mapped file
+        size_t size;
+        bool damaged;                   // a chunk failed to inflate
+
+        int walksPerChunk;
+        std::vector<boost::uint64_t> chunkOffset, chunkStored, chunkRaw, chunkCompressed;
+        std::vector<boost::uint64_t> walkOffset, walkSteps;
+
+        // most recently decompressed chunk
+        long cachedChunk;
+        std::vector<boost::uint8_t> cache;
+
+        const boost::uint8_t *walkData(boost::uint64_t k);
+        void damagedFile(const std::string &filename);
+};
+
+#endif   /* ----- #ifndef TRAJECTORY_INC  ----- */
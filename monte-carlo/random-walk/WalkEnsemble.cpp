@@ -0,0 +1,50 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  WalkEnsemble.cpp
+ *
+ *    Description:  Runs independent shards of a walk experiment across several
+ *                  threads and combines their averages
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include "WalkEnsemble.h"
+#include "helpers/rng.h"
+
+#include <atomic>
+#include <thread>
+
+WalkStats runEnsemble(const std::vector<int> &checkpoints, int shards, int threads,
+                      unsigned int seed, const ShardJob &job) {
+
+    // every shard gets its own accumulator, so threads never write
+    // to the same data and nothing needs locking
+    std::vector<WalkStats> results(shards, WalkStats(checkpoints));
+
+    // threads take the next shard off a shared counter until all are done
+    std::atomic<int> nextShard(0);
+
+    auto worker = [&]() {
+        for (int s = nextShard++; s < shards; s = nextShard++)
+            job(s, streamSeed(seed, s), results[s]);
+    };
+
+    if (threads < 1) threads = 1;
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.push_back(std::thread(worker));
+    worker();       // the calling thread does its share too
+
+    for (size_t t = 0; t < pool.size(); ++t) pool[t].join();
+
+    // combine in shard order, so the floating point sums are
+    // always done in the same order
+    WalkStats total(checkpoints);
+    for (int s = 0; s < shards; ++s) total.merge(results[s]);
+
+    return total;
+}
@@ -0,0 +1,35 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  WalkEnsemble.h
+ *
+ *    Description:  Runs independent shards of a walk experiment across several
+ *                  threads and combines their averages
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+
+#ifndef  WALKENSEMBLE_INC
+#define  WALKENSEMBLE_INC
+
+#include <vector>
+#include <functional>
+
+#include "WalkStats.h"
+
+// One shard of the experiment: fill in stats using only the given
+// seed for random numbers (and no shared state), so that each shard
+// gives the same answer whichever thread happens to run it.
+typedef std::function<void (int shard, unsigned int seed, WalkStats &stats)> ShardJob;
+
+// Run shards 0..(shards - 1) on the given number of threads and return
+// the combined averages. The result only depends on seed and shards,
+// not on the number of threads or the order the shards finish in.
+WalkStats runEnsemble(const std::vector<int> &checkpoints, int shards, int threads,
+                      unsigned int seed, const ShardJob &job);
+
+#endif   /* ----- #ifndef WALKENSEMBLE_INC  ----- */
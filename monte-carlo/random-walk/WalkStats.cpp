@@ -0,0 +1,48 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  WalkStats.cpp
+ *
+ *    Description:  Streaming averages of <R>, <R^2>, <|x|> and <|y|> taken at a
+ *                  fixed set of checkpoint walk lengths
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include "WalkStats.h"
+#include <cmath>
+#include <cstdlib>
+
+WalkStats::WalkStats(const std::vector<int> &checkpoints) :
+    checkpoints_(checkpoints), wSum(checkpoints.size()),
+    rSum(checkpoints.size()), r2Sum(checkpoints.size()),
+    xSum(checkpoints.size()), ySum(checkpoints.size()) {
+}
+
+
+void WalkStats::addWalk(int c, int x, int y, double weight) {
+
+    // use doubles for R^2 as x^2 overflows an int for very long walks
+    double r2 = double(x) * x + double(y) * y;
+
+    wSum[c] += weight;
+    rSum[c] += weight * sqrt(r2);
+    r2Sum[c] += weight * r2;
+    xSum[c] += weight * std::abs(x);
+    ySum[c] += weight * std::abs(y);
+}
+
+
+void WalkStats::merge(const WalkStats &other) {
+
+    for (int c = 0; c < size(); ++c) {
+        wSum[c] += other.wSum[c];
+        rSum[c] += other.rSum[c];
+        r2Sum[c] += other.r2Sum[c];
+        xSum[c] += other.xSum[c];
+        ySum[c] += other.ySum[c];
+    }
+}
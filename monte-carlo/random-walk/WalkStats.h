@@ -0,0 +1,52 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  WalkStats.h
+ *
+ *    Description:  Streaming averages of <R>, <R^2>, <|x|> and <|y|> taken at a
+ *                  fixed set of checkpoint walk lengths
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+
+#ifndef  WALKSTATS_INC
+#define  WALKSTATS_INC
+
+#include <vector>
+
+class WalkStats {
+    public:
+        // checkpoints must be in increasing order
+        explicit WalkStats(const std::vector<int> &checkpoints);
+
+        // record one walk of length checkpoint(c) ending at (x, y),
+        // weighted for samplers that don't draw walks uniformly
+        void addWalk(int c, int x, int y, double weight = 1.0);
+
+        // fold in the sums from another set of walks
+        // (must have been built with the same checkpoints)
+        void merge(const WalkStats &other);
+
+        // simple getters
+        int size() const { return checkpoints_.size(); }
+        int checkpoint(int c) const { return checkpoints_[c]; }
+        double totalWeight(int c) const { return wSum[c]; }
+
+        double meanR(int c) const { return rSum[c] / wSum[c]; }
+        double meanR2(int c) const { return r2Sum[c] / wSum[c]; }
+        double meanAbsX(int c) const { return xSum[c] / wSum[c]; }
+        double meanAbsY(int c) const { return ySum[c] / wSum[c]; }
+
+    private:
+        std::vector<int> checkpoints_;
+
+        // running sums, one entry per checkpoint
+        std::vector<double> wSum;
+        std::vector<double> rSum, r2Sum, xSum, ySum;
+};
+
+#endif   /* ----- #ifndef WALKSTATS_INC  ----- */
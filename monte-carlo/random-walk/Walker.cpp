@@ -16,11 +16,16 @@
 #include <cmath>    // uses sqrt() for norms
 #include <ctime>    // for seeding RNG
 #include <iostream>     // for debugging / output
-#include <cstdlib>      // for inital move
 
 // default constructor
-Walker::Walker() : xPos(0), yPos(0), prevStep(0), dist(1, 3), randStep(gen, dist) {
-    gen.seed( static_cast<unsigned int>(std::time(0)) );      // seed with system clock
+Walker::Walker() : Walker(static_cast<unsigned int>(std::time(0))) {      // seed with system clock
+}
+
+
+// walkers built with different seeds give independent walks, even
+// when they are created at the same time (e.g. one per thread)
+Walker::Walker(unsigned int seed) : xPos(0), yPos(0), prevStep(0), dist(1, 3), randStep(gen, dist) {
+    gen.seed(seed);
     reset();
 }
 
@@ -30,8 +35,9 @@ void Walker::reset() {
 
     xPos = yPos = 0;
 
-    // initial move in *any* direction
-    int initialMove = rand() % 4;
+    // initial move in *any* direction (use our own generator
+    // rather than rand(), which is shared between all walkers)
+    int initialMove = gen() % 4;
     applyMove(initialMove);
     
     prevStep = initialMove;
@@ -25,7 +25,8 @@
 
 class Walker {
     public:
-        Walker();           // default constructor
+        Walker();           // default constructor (seeded from the clock)
+        explicit Walker(unsigned int seed);
 
         // restarting public methods
         void reset();
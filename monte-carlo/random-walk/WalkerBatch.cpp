@@ -0,0 +1,122 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  WalkerBatch.cpp
+ *
+ *    Description:  Many independent non-reversing walkers on a 2D lattice, advanced
+ *                  together in structure-of-arrays form
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include "WalkerBatch.h"
+#include "helpers/rng.h"
+#include <cmath>    // uses sqrt() for norms
+
+
+// The x / y increments for each direction are packed two bits per
+// move into a single integer, offset by one so they are never negative:
+//
+//     move:     UP  RIGHT  DOWN  LEFT
+//     dx + 1:    1      2     1     0     ->  0b00011001
+//     dy + 1:    2      1     0     1     ->  0b01000110
+//
+// so looking up a move is a shift and a mask rather than a switch,
+// which lets the compiler vectorise the whole update loop.
+static const unsigned int DX_TABLE = 0x19;
+static const unsigned int DY_TABLE = 0x46;
+
+inline int dxOf(int move) { return int((DX_TABLE >> (2 * move)) & 3u) - 1; }
+inline int dyOf(int move) { return int((DY_TABLE >> (2 * move)) & 3u) - 1; }
+
+
+WalkerBatch::WalkerBatch(int walkers, unsigned int seed) :
+    walkers_(walkers), steps_(0), xPos(walkers), yPos(walkers), prevStep(walkers), record_(false), randBuffer(walkers) {
+
+    gen.seed(seed);
+    reset();
+}
+
+
+// re-centre all the walkers on the lattice
+void WalkerBatch::reset() {
+
+    fillRandom();
+
+    if (record_) trail.assign(walkers_, 0);
+    else trail.clear();
+
+    for (int k = 0; k < walkers_; ++k) {
+
+        // initial move in *any* direction
+        int move = scaleRandom(randBuffer[k], 4);
+
+        xPos[k] = dxOf(move);
+        yPos[k] = dyOf(move);
+        prevStep[k] = move;
+
+        if (record_) trail[k] = move;
+    }
+
+    steps_ = 1;
+}
+
+
+// random numbers are drawn for the whole batch in one go
+// so that the generator is not interleaved with the updates
+void WalkerBatch::fillRandom() {
+    for (int k = 0; k < walkers_; ++k) randBuffer[k] = gen();
+}
+
+
+// perform _one_ random step for every walker, excluding the
+// direction each one just came from (see Walker::moveStep)
+void WalkerBatch::moveStep() {
+
+    fillRandom();
+
+    const boost::uint32_t *r = &randBuffer[0];
+    int *x = &xPos[0], *y = &yPos[0], *prev = &prevStep[0];
+
+    // start a new row of recorded moves every fourth step
+    boost::uint8_t *row = 0;
+    int shift = 2 * (steps_ % 4);
+
+    if (record_) {
+        if (shift == 0) trail.resize(trail.size() + walkers_, 0);
+        row = &trail[trail.size() - walkers_];
+    }
+
+    for (int k = 0; k < walkers_; ++k) {
+
+        // a turn on [1, 3] plus 2 (to flip) then wrapped with "mod 4"
+        int move = (prev[k] + scaleRandom(r[k], 3) + 3) & 3;
+
+        x[k] += dxOf(move);
+        y[k] += dyOf(move);
+        prev[k] = move;
+
+        if (row) row[k] |= move << shift;
+    }
+
+    ++steps_;
+}
+
+
+void WalkerBatch::packedMoves(int k, std::vector<boost::uint8_t> &out) const {
+
+    size_t rows = trail.size() / walkers_;
+
+    out.resize(rows);
+    for (size_t r = 0; r < rows; ++r) out[r] = trail[r * walkers_ + k];
+}
+
+
+// returns R = sqrt(x^2 + y^2)
+double WalkerBatch::endToEndDist(int k) const {
+    double x = xPos[k], y = yPos[k];
+    return sqrt(x * x + y * y);
+}
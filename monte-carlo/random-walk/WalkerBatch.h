@@ -0,0 +1,76 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  WalkerBatch.h
+ *
+ *    Description:  Many independent non-reversing walkers on a 2D lattice, advanced
+ *                  together in structure-of-arrays form
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+
+#ifndef  WALKERBATCH_INC
+#define  WALKERBATCH_INC
+
+#include <vector>
+
+// boost RNG libraries
+#include <boost/cstdint.hpp>
+#include <boost/random/mersenne_twister.hpp>
+
+class WalkerBatch {
+    public:
+        WalkerBatch(int walkers, unsigned int seed);
+
+        // move every walker back to (0, 0) and take the initial step
+        void reset();
+
+        // perform N steps for every walker
+        // (N - 1) because initial step is performed on reset
+        void performWalk(int N) { for (int step = 0; step < (N - 1); step++) moveStep(); }
+
+        // carry on the current walks until they are N steps long
+        void extendTo(int N) { while (steps_ < N) moveStep(); }
+
+        // simple getters
+        int size() const { return walkers_; }
+        int steps() const { return steps_; }
+        const int &x(int k) const { return xPos[k]; }
+        const int &y(int k) const { return yPos[k]; }
+
+        // find R for walker k
+        double endToEndDist(int k) const;
+
+        // keep every move (from the next reset onwards) so that the
+        // walks can be written out with a TrajectoryWriter afterwards
+        void recordMoves(bool record) { record_ = record; }
+
+        // moves of walker k so far, packed 2 bits per step
+        void packedMoves(int k, std::vector<boost::uint8_t> &out) const;
+
+    private:
+        int walkers_;
+        int steps_;         // length of the current walks
+
+        // one entry per walker
+        std::vector<int> xPos, yPos;    // current positions
+        std::vector<int> prevStep;      // previous move (UP = 0, RIGHT = 1, DOWN = 2, LEFT = 3)
+
+        // recorded moves, packed 4 steps to a byte: byte k of
+        // row r holds steps 4r to 4r + 3 of walker k
+        bool record_;
+        std::vector<boost::uint8_t> trail;
+
+        // raw random words, one per walker per step
+        std::vector<boost::uint32_t> randBuffer;
+        boost::mt19937 gen;
+
+        void fillRandom();      // draw a fresh random word for every walker
+        void moveStep();        // move every walker one random step
+};
+
+#endif   /* ----- #ifndef WALKERBATCH_INC  ----- */
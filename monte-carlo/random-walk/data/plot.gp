@@ -3,6 +3,7 @@ set xlabel "N (number of steps)"
 set ylabel "<R> Mean end-to-end distance"
 plot 	"output.dat" using 1:2 title "simulation" with points, \
 	"output.dat" using 1:3 title "sqrt(N)" with lines
-#	"output.dat" using 1:3 title "<x>" with lines, 
-#	"output.dat" using 1:4 title "<y>" with lines
-
+#	"output.dat" using 1:4 title "<R^2>" with points,
+#	"output.dat" using 1:5 title "<|x|>" with lines,
+#	"output.dat" using 1:6 title "<|y|>" with lines
+#	"output.dat" using 1:($1**0.75) title "N^(3/4) (self-avoiding)" with lines
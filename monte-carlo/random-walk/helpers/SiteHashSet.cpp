@@ -0,0 +1,79 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  SiteHashSet.cpp
+ *
+ *    Description:  Open-addressing hash table of occupied lattice sites, storing the
+ *                  index along the walk of the step which occupies each site
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include "SiteHashSet.h"
+
+SiteHashSet::SiteHashSet(int maxSites) {
+
+    // smallest power of two with at least twice as many slots as sites
+    boost::uint64_t slots = 16;
+    while (slots < 2 * boost::uint64_t(maxSites)) slots <<= 1;
+
+    keys.resize(slots);
+    indices.assign(slots, -1);
+    mask = slots - 1;
+}
+
+
+int SiteHashSet::find(int x, int y) const {
+
+    boost::uint64_t key = pack(x, y);
+
+    for (boost::uint64_t s = slotOf(key); ; s = (s + 1) & mask) {
+        if (indices[s] < 0) return -1;
+        if (keys[s] == key) return indices[s];
+    }
+}
+
+
+void SiteHashSet::insert(int x, int y, int index) {
+
+    boost::uint64_t key = pack(x, y);
+    boost::uint64_t s = slotOf(key);
+
+    while (indices[s] >= 0 && keys[s] != key) s = (s + 1) & mask;
+
+    keys[s] = key;
+    indices[s] = index;
+}
+
+
+// Deletion without tombstones: after emptying a slot, any later entry
+// in the same probe run which could no longer be reached from its home
+// slot is shifted back into the gap.
+void SiteHashSet::erase(int x, int y) {
+
+    boost::uint64_t key = pack(x, y);
+    boost::uint64_t gap = slotOf(key);
+
+    while (keys[gap] != key || indices[gap] < 0) gap = (gap + 1) & mask;
+    indices[gap] = -1;
+
+    for (boost::uint64_t s = (gap + 1) & mask; indices[s] >= 0; s = (s + 1) & mask) {
+
+        // distance of this entry from its home slot, and of the gap
+        boost::uint64_t home = slotOf(keys[s]);
+        if (((s - home) & mask) >= ((s - gap) & mask)) {
+            keys[gap] = keys[s];
+            indices[gap] = indices[s];
+            indices[s] = -1;
+            gap = s;
+        }
+    }
+}
+
+
+void SiteHashSet::clear() {
+    indices.assign(indices.size(), -1);
+}
@@ -0,0 +1,55 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  SiteHashSet.h
+ *
+ *    Description:  Open-addressing hash table of occupied lattice sites, storing the
+ *                  index along the walk of the step which occupies each site
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+
+#ifndef  SITEHASHSET_INC
+#define  SITEHASHSET_INC
+
+#include <vector>
+#include <boost/cstdint.hpp>
+
+class SiteHashSet {
+    public:
+        // sized so that the table is never more than half full
+        // when holding up to maxSites sites
+        explicit SiteHashSet(int maxSites);
+
+        // returns the index stored for site (x, y), or -1 if it is empty
+        int find(int x, int y) const;
+
+        // mark (x, y) as occupied by step "index" (overwrites any old index)
+        void insert(int x, int y, int index);
+
+        // free the site (x, y), which must currently be occupied
+        void erase(int x, int y);
+
+        void clear();
+
+    private:
+        // linear probing, with empty slots marked by index -1
+        std::vector<boost::uint64_t> keys;
+        std::vector<int> indices;
+        boost::uint64_t mask;
+
+        static boost::uint64_t pack(int x, int y) {
+            return (boost::uint64_t(boost::uint32_t(x)) << 32) | boost::uint32_t(y);
+        }
+
+        // Fibonacci hashing of the packed coordinates
+        boost::uint64_t slotOf(boost::uint64_t key) const {
+            return ((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+        }
+};
+
+#endif   /* ----- #ifndef SITEHASHSET_INC  ----- */
@@ -0,0 +1,45 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  rng.h
+ *
+ *    Description:  Small helpers for turning raw random words into lattice moves
+ *                  and for seeding independent random number streams
+ *
+ *        Version:  1.0
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+
+#ifndef  RNG_INC
+#define  RNG_INC
+
+#include <boost/cstdint.hpp>
+
+// map a raw 32 bit word onto {0, 1, ..., n - 1} (multiply-shift,
+// the bias is of order n / 2^32 which is far below our statistics)
+inline int scaleRandom(boost::uint32_t r, boost::uint64_t n) {
+    return int((boost::uint64_t(r) * n) >> 32);
+}
+
+// map a raw 32 bit word onto [0, 1)
+inline double unitRandom(boost::uint32_t r) {
+    return r * (1.0 / 4294967296.0);
+}
+
+// derive the seed for one independent stream (e.g. shard "stream" of a
+// run) from the seed of the whole run, by scrambling both with the
+// splitmix64 finaliser so that neighbouring streams are uncorrelated
+inline boost::uint32_t streamSeed(boost::uint32_t seed, boost::uint64_t stream) {
+
+    boost::uint64_t z = (boost::uint64_t(seed) << 32) ^ (stream * 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z = z ^ (z >> 31);
+
+    return boost::uint32_t(z >> 32);
+}
+
+#endif   /* ----- #ifndef RNG_INC  ----- */
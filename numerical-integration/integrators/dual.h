@@ -0,0 +1,43 @@
+#ifndef DUAL_H
+#define DUAL_H
+
+#include <cmath>
+
+/* Dual numbers a + b e, with e^2 = 0, for forward mode automatic
+   differentiation: if every input x carries a derivative dx/ds in its
+   dual part, then after any sequence of arithmetic every result f
+   carries df/ds, exact to rounding (unlike a finite difference, which
+   loses half the digits). A system written as a template on its number
+   type can be called with Dual states to get columns of its Jacobian
+   (see jacobian.h).
+*/
+struct Dual
+{
+    double v, d;    // value and derivative
+
+    Dual(double v = 0.0, double d = 0.0) : v(v), d(d) {}
+
+    Dual &operator+=(const Dual &b) { v += b.v; d += b.d; return *this; }
+    Dual &operator-=(const Dual &b) { v -= b.v; d -= b.d; return *this; }
+    Dual &operator*=(const Dual &b) { d = d * b.v + v * b.d; v *= b.v; return *this; }
+    Dual &operator/=(const Dual &b) { d = (d * b.v - v * b.d) / (b.v * b.v); v /= b.v; return *this; }
+};
+
+inline Dual operator+(Dual a, const Dual &b) { return a += b; }
+inline Dual operator-(Dual a, const Dual &b) { return a -= b; }
+inline Dual operator*(Dual a, const Dual &b) { return a *= b; }
+inline Dual operator/(Dual a, const Dual &b) { return a /= b; }
+inline Dual operator-(const Dual &a) { return Dual(-a.v, -a.d); }
+
+inline bool operator<(const Dual &a, const Dual &b) { return a.v < b.v; }
+inline bool operator>(const Dual &a, const Dual &b) { return a.v > b.v; }
+
+// the chain rule for the usual functions
+inline Dual sqrt(const Dual &a) { const double s = std::sqrt(a.v); return Dual(s, 0.5 * a.d / s); }
+inline Dual exp(const Dual &a) { const double e = std::exp(a.v); return Dual(e, e * a.d); }
+inline Dual log(const Dual &a) { return Dual(std::log(a.v), a.d / a.v); }
+inline Dual sin(const Dual &a) { return Dual(std::sin(a.v), std::cos(a.v) * a.d); }
+inline Dual cos(const Dual &a) { return Dual(std::cos(a.v), -std::sin(a.v) * a.d); }
+inline Dual pow(const Dual &a, double p) { const double q = std::pow(a.v, p - 1); return Dual(q * a.v, p * q * a.d); }
+
+#endif
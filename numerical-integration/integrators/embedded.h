@@ -0,0 +1,252 @@
+#ifndef EMBEDDED_H
+#define EMBEDDED_H
+
+#include <cmath>
+#include <algorithm>
+
+#include "state.h"
+
+/* Butcher tableaux of embedded Runge-Kutta pairs. Each gives
+
+   - the nodes c and the stage matrix a (lower triangle, row by row, so
+     stage s uses a[s (s - 1) / 2] .. a[s (s - 1) / 2 + s - 1]),
+   - the weights b of the solution that is kept, and e, the difference
+     between those and the weights of the embedded lower order solution,
+     so h sum e_i k_i estimates the error of the step,
+   - where the derivative at the end of the step ends up (end): the last
+     stage if the method is FSAL (first same as last), otherwise an extra
+     slot after the stages, which the stepper fills itself,
+   - the weights of the dense output (interpolant) at theta = (t - t0) / h,
+     for theta from 0 to 1, over the stages and the end derivative.
+*/
+
+// Dormand & Prince (1980) 5(4), FSAL, with Shampine's fourth order interpolant
+struct DormandPrince
+{
+    enum { stages = 7, order = 5, end = 6 };
+
+    static constexpr double c[stages] = { 0.0, 1 / 5.0, 3 / 10.0, 4 / 5.0, 8 / 9.0, 1.0, 1.0 };
+    static constexpr double a[stages * (stages - 1) / 2] = {
+        1 / 5.0,
+        3 / 40.0, 9 / 40.0,
+        44 / 45.0, -56 / 15.0, 32 / 9.0,
+        19372 / 6561.0, -25360 / 2187.0, 64448 / 6561.0, -212 / 729.0,
+        9017 / 3168.0, -355 / 33.0, 46732 / 5247.0, 49 / 176.0, -5103 / 18656.0,
+        35 / 384.0, 0.0, 500 / 1113.0, 125 / 192.0, -2187 / 6784.0, 11 / 84.0
+    };
+    static constexpr double b[stages] = {
+        35 / 384.0, 0.0, 500 / 1113.0, 125 / 192.0, -2187 / 6784.0, 11 / 84.0, 0.0
+    };
+    static constexpr double e[stages] = {
+        71 / 57600.0, 0.0, -71 / 16695.0, 71 / 1920.0, -17253 / 339200.0, 22 / 525.0, -1 / 40.0
+    };
+
+    static void dense(double theta, double *w)
+    {
+        // w_i = sum_p P_ip theta^(p + 1)
+        static const double P[stages][4] = {
+            { 1.0, -8048581381 / 2820520608.0, 8663915743 / 2820520608.0, -12715105075 / 11282082432.0 },
+            { 0.0, 0.0, 0.0, 0.0 },
+            { 0.0, 131558114200 / 32700410799.0, -68118460800 / 10900136933.0, 87487479700 / 32700410799.0 },
+            { 0.0, -1754552775 / 470086768.0, 14199869525 / 1410260304.0, -10690763975 / 1880347072.0 },
+            { 0.0, 127303824393 / 49829197408.0, -318862633887 / 49829197408.0, 701980252875 / 199316789632.0 },
+            { 0.0, -282668133 / 205662961.0, 2019193451 / 616988883.0, -1453857185 / 822651844.0 },
+            { 0.0, 40617522 / 29380423.0, -110615467 / 29380423.0, 69997945 / 29380423.0 }
+        };
+        for (int i = 0; i < stages; ++i)
+            w[i] = theta * (P[i][0] + theta * (P[i][1] + theta * (P[i][2] + theta * P[i][3])));
+        w[stages] = 0.0;
+    }
+};
+
+// Cash & Karp (1990) 5(4); no interpolant of its own, so cubic Hermite
+// between the two ends of the step
+struct CashKarp
+{
+    enum { stages = 6, order = 5, end = 6 };
+
+    static constexpr double c[stages] = { 0.0, 1 / 5.0, 3 / 10.0, 3 / 5.0, 1.0, 7 / 8.0 };
+    static constexpr double a[stages * (stages - 1) / 2] = {
+        1 / 5.0,
+        3 / 40.0, 9 / 40.0,
+        3 / 10.0, -9 / 10.0, 6 / 5.0,
+        -11 / 54.0, 5 / 2.0, -70 / 27.0, 35 / 27.0,
+        1631 / 55296.0, 175 / 512.0, 575 / 13824.0, 44275 / 110592.0, 253 / 4096.0
+    };
+    static constexpr double b[stages] = {
+        37 / 378.0, 0.0, 250 / 621.0, 125 / 594.0, 0.0, 512 / 1771.0
+    };
+    static constexpr double e[stages] = {
+        37 / 378.0 - 2825 / 27648.0, 0.0, 250 / 621.0 - 18575 / 48384.0,
+        125 / 594.0 - 13525 / 55296.0, -277 / 14336.0, 512 / 1771.0 - 1 / 4.0
+    };
+
+    static void dense(double theta, double *w)
+    {
+        // y(theta) = y0 + H01 (y1 - y0) + h H10 f0 + h H11 f1, with y1 - y0 = h sum b_i k_i
+        const double t2 = theta * theta, t3 = t2 * theta;
+        const double h01 = 3 * t2 - 2 * t3, h10 = theta - 2 * t2 + t3, h11 = t3 - t2;
+        for (int i = 0; i < stages; ++i) w[i] = h01 * b[i];
+        w[0] += h10;
+        w[stages] = h11;
+    }
+};
+
+
+/* Adaptive integrator using an embedded pair (Method, one of the
+   tableaux above), for the same systems and states as RK4Stepper.
+
+   Each step estimates its own error from the difference of the two
+   solutions of the pair, and is only accepted if that is within
+   atol + rtol |y| for every variable; otherwise it is retried with a
+   shorter step. The next step is then chosen to aim for the tolerance,
+   so the stepper takes long steps where the solution is smooth and
+   short ones where it is not. The derivative at the end of a step is
+   the first stage of the next, so an accepted step costs stages - 1
+   calls to the system.
+
+   Between steps the stepper keeps both ends of the last step and all
+   of its stages, which give the solution anywhere inside that step
+   (interpolate()) at the cost of one combination of the stages, and
+   let event() find where a function of the solution crosses zero.
+*/
+template <class System, class State, class Method = DormandPrince>
+class EmbeddedStepper
+{
+    public:
+        EmbeddedStepper(System &system, double atol, double rtol, double h_max = HUGE_VAL)
+            : system(system), atol(atol), rtol(rtol), h_max(h_max),
+              t(0.0), t_old(0.0), h(0.0), h_last(0.0), calls(0), accepted(0), rejected(0) {}
+
+        static int order() { return Method::order; }
+
+        // start from y at time t, trying a first step of h_first
+        void reset(double t_start, const State &y_start, double h_first)
+        {
+            t = t_old = t_start;
+            y = y_old = y_start;
+            h = std::min(h_first, h_max);
+            h_last = 0.0;
+            system(t, y, k[Method::end]);
+            ++calls;
+        }
+
+        /* Take one step (retrying until the error is small enough), but
+           not past t_end. Returns false, without moving, if the step has
+           had to shrink to nothing.
+        */
+        bool step(double t_end)
+        {
+            const int S = Method::stages;
+            const double h_min = 16 * std::fabs(t) * 2.2e-16;
+            k[0] = k[Method::end];
+
+            for (bool retry = false; ; retry = true)
+            {
+                // finish exactly on t_end rather than leave a sliver
+                double hs = (t + 1.01 * h >= t_end) ? t_end - t : h;
+                if (hs <= h_min) return false;
+
+                for (int s = 1; s < S; ++s)
+                {
+                    StateOps<State>::combine(temp, y, hs, &Method::a[s * (s - 1) / 2], k, s);
+                    system(t + Method::c[s] * hs, temp, k[s]);
+                }
+                StateOps<State>::combine(y_new, y, hs, Method::b, k, S);
+                calls += S - 1;
+
+                double err = StateOps<State>::error(y, y_new, hs, Method::e, k, S, atol, rtol);
+
+                // the usual controller, with a safety factor and bounded changes
+                double factor = (err == 0.0) ? 5.0 : 0.9 * std::pow(err, -1.0 / Method::order);
+                factor = std::min(5.0, std::max(0.2, factor));
+
+                if (err <= 1.0)
+                {
+                    t_old = t;
+                    y_old = y;
+                    y = y_new;
+                    h_last = hs;
+                    t += hs;
+                    if (Method::end == S) { system(t, y, k[S]); ++calls; }
+
+                    h = std::min(h_max, hs * (retry ? std::min(factor, 1.0) : factor));
+                    ++accepted;
+                    return true;
+                }
+
+                h = hs * factor;
+                ++rejected;
+            }
+        }
+
+        // the solution at t_i, which must be within the last step
+        void interpolate(double t_i, State &out) const
+        {
+            double w[Method::stages + 1];
+            Method::dense((t_i - t_old) / h_last, w);
+            StateOps<State>::combine(out, y_old, h_last, w, k, Method::stages + 1);
+        }
+
+        /* Find the first point in the last step where g(t, y) reaches
+           zero, having been non zero at its start; if there is one, set
+           t_event and y_event to it and return true. The search is on the
+           interpolant, by regula falsi (Illinois variant), so costs no
+           calls to the system.
+        */
+        template <class Event>
+        bool event(Event g, double &t_event, State &y_event, double tol = 1e-12) const
+        {
+            double t0 = t_old, t1 = t;
+            double g0 = g(t0, y_old), g1 = g(t1, y);
+            if (g0 == 0.0 || (g1 != 0.0 && (g0 < 0) == (g1 < 0))) return false;
+
+            t_event = t1;
+            y_event = y;
+            int side = 0;
+            for (int iter = 0; iter < 100 && g1 != 0.0 && t1 - t0 > tol * std::max(1.0, std::fabs(t1)); ++iter)
+            {
+                double tm = t1 - g1 * (t1 - t0) / (g1 - g0);
+                tm = std::min(std::max(tm, t0), t1);
+                interpolate(tm, y_event);
+                double gm = g(tm, y_event);
+                t_event = tm;
+                if (gm == 0.0) break;
+
+                // keep the bracket [t0, t1], halving the weight of an end that stays put
+                if ((gm < 0) == (g1 < 0))
+                {
+                    t1 = tm; g1 = gm;
+                    if (side == -1) g0 *= 0.5;
+                    side = -1;
+                }
+                else
+                {
+                    t0 = tm; g0 = gm;
+                    if (side == 1) g1 *= 0.5;
+                    side = 1;
+                }
+            }
+            return true;
+        }
+
+        double time() const { return t; }
+        const State &state() const { return y; }
+        double stepSize() const { return h; }
+
+        // number of calls to the system, and of accepted / rejected steps
+        long evaluations() const { return calls; }
+        long acceptedSteps() const { return accepted; }
+        long rejectedSteps() const { return rejected; }
+
+    private:
+        System &system;
+        double atol, rtol, h_max;
+
+        double t, t_old, h, h_last;
+        State y, y_old, y_new, temp;
+        State k[Method::stages + 1];
+        long calls, accepted, rejected;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <vector>
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+#include "state.h"
+
+// value of lane l of a double (a single lane) or a vector type
+inline double lane(double x, int) { return x; }
+inline void setLane(double &x, int, double value) { x = value; }
+
+template <class V>
+inline double lane(const V &v, int l) { return v[l]; }
+template <class V>
+inline void setLane(V &v, int l, double value) { v[l] = value; }
+
+
+/* An ensemble of independent copies (members) of a system of N
+   equations, e.g. one per initial condition or parameter value.
+
+   The members are stored in blocks of as many as fit in one Lanes
+   vector (8 for Vec8), and within a block variable by variable, so
+   variable n of the block's members is one contiguous Lanes: a block
+   loads straight into a std::array<Lanes, N>, the state type of the
+   steppers, and one call of the system then works out the derivative
+   of every member of the block at once, a lane each. Lanes = double
+   gives plain one at a time integration, for comparison.
+
+   The stages of a step depend on each other, so a small system spends
+   most of its step waiting for the results of the last operation; Vec8
+   is two AVX (or four SSE) vectors, whose independent operations fill
+   those gaps, and was about twice as fast as Vec4 for small systems.
+*/
+template <int N, class Lanes = Vec8>
+class Ensemble
+{
+    public:
+        enum { width = sizeof(Lanes) / sizeof(double) };
+        typedef std::array<Lanes, N> Block;
+
+        explicit Ensemble(int members)
+            : members(members), blocks((members + width - 1) / width),
+              data(std::size_t(blocks) * N * width, 0.0), t_stop(members, HUGE_VAL) {}
+
+        int size() const { return members; }
+        int blockCount() const { return blocks; }
+
+        // variable n of member m
+        double &operator()(int m, int n) { return data[index(m, n)]; }
+        double operator()(int m, int n) const { return data[index(m, n)]; }
+
+        // time at which member m was stopped by the event (HUGE_VAL if it wasn't)
+        double stopTime(int m) const { return t_stop[m]; }
+        void setStopTime(int m, double t) { t_stop[m] = t; }
+
+        /* Block b as a state; the spare lanes of the last block are
+           filled with copies of the last member, so they do harmless
+           arithmetic.
+        */
+        void load(int b, Block &y) const
+        {
+            for (int n = 0; n < N; ++n)
+                for (int l = 0; l < width; ++l)
+                    setLane(y[n], l, data[index(std::min(b * width + l, members - 1), n)]);
+        }
+
+        // write back lane l of block b (if it is a member)
+        void store(int b, int l, const Block &y)
+        {
+            const int m = b * width + l;
+            if (m >= members) return;
+            for (int n = 0; n < N; ++n) data[index(m, n)] = lane(y[n], l);
+        }
+
+    private:
+        int members, blocks;
+        std::vector<double> data;
+        std::vector<double> t_stop;
+
+        std::size_t index(int m, int n) const
+        {
+            return (std::size_t(m / width) * N + n) * width + m % width;
+        }
+};
+
+
+// never stops anything
+struct NoEvent
+{
+    template <class State>
+    double operator()(double, const State &) const { return 1.0; }
+};
+
+
+/* Integrate every member of the ensemble from t_0 to t_max with steps
+   of h, using a Stepper<System, Ensemble::Block> (RK4Stepper,
+   MapStepper, ...) on each block, and leave the final states in the
+   ensemble. Blocks are shared dynamically between threads, since
+   members may stop at very different times.
+
+   A member is stopped (masked off) after the first step which takes
+   event(t, y) below zero, for its lane: its state after that step is
+   written back and its stop time recorded, and the rest of the block
+   carries on. The event is called on whole blocks (it is a template,
+   or takes Block) and returns either one value for all lanes or a
+   Lanes of values. Returns the number of member steps taken.
+*/
+template <template <class, class> class Stepper, class System, int N, class Lanes, class Event>
+long integrate(Ensemble<N, Lanes> &ensemble, System &system, double t_0, double t_max, double h,
+               Event event)
+{
+    typedef typename Ensemble<N, Lanes>::Block Block;
+    const int width = Ensemble<N, Lanes>::width;
+    const long steps = long(std::ceil((t_max - t_0) / h - 1e-9));
+    long total = 0;
+
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+:total)
+    for (int b = 0; b < ensemble.blockCount(); ++b)
+    {
+        Stepper<System, Block> stepper(system);
+        Block y = Block();
+        ensemble.load(b, y);
+
+        // one bit per lane still running
+        unsigned live = 0;
+        const auto g_0 = event(t_0, y);
+        for (int l = 0; l < width && b * width + l < ensemble.size(); ++l)
+            if (!(lane(g_0, l) < 0)) live |= 1u << l;
+            else ensemble.setStopTime(b * width + l, t_0);
+
+        for (long step = 0; live && step < steps; ++step)
+        {
+            const double t = t_0 + step * h;
+            stepper.step(y, t, h);
+            total += __builtin_popcount(live);
+
+            const auto g = event(t + h, y);
+            for (int l = 0; l < width; ++l)
+                if ((live & (1u << l)) && lane(g, l) < 0)
+                {
+                    ensemble.store(b, l, y);
+                    ensemble.setStopTime(b * width + l, t + h);
+                    live &= ~(1u << l);
+                }
+        }
+
+        for (int l = 0; l < width; ++l)
+            if (live & (1u << l)) ensemble.store(b, l, y);
+    }
+
+    return total;
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef JACOBIAN_H
+#define JACOBIAN_H
+
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+#include "dual.h"
+
+/* Ways of working out the Jacobian J = df/dy of a system of N
+   equations, into a linear solver of linear.h, as
+
+       Method::evaluate(system, t, y, f, solver)
+
+   with f = f(t, y) already known. Only the entries inside the solver's
+   band are wanted, so the columns are perturbed in groups: columns
+   lower + upper + 1 apart touch different rows, so a whole group can be
+   done with one call to the system (Curtis, Powell & Reid, 1974). A
+   dense J takes N calls, a tridiagonal one 3, whatever N. Returns the
+   number of calls made.
+*/
+
+// one sided differences, with the step scaled to each variable
+struct FiniteDifference
+{
+    template <class System, class Linear, std::size_t N>
+    static int evaluate(System &system, double t, const std::array<double, N> &y,
+                        const std::array<double, N> &f, Linear &solver)
+    {
+        const int n = int(N), groups = std::min(n, int(Linear::lower) + int(Linear::upper) + 1);
+        const double root_eps = 1.5e-8;
+        std::array<double, N> yp(y), fp;
+        std::array<double, N> step;
+
+        for (int g = 0; g < groups; ++g)
+        {
+            for (int j = g; j < n; j += groups)
+            {
+                step[j] = root_eps * std::max(std::fabs(y[j]), 1.0);
+                yp[j] = y[j] + step[j];
+                step[j] = yp[j] - y[j];         // the step actually taken
+            }
+            system(t, yp, fp);
+
+            for (int j = g; j < n; j += groups)
+            {
+                for (int i = std::max(0, j - int(Linear::upper)); i <= std::min(n - 1, j + int(Linear::lower)); ++i)
+                    solver.setJacobian(i, j, (fp[i] - f[i]) / step[j]);
+                yp[j] = y[j];
+            }
+        }
+        return groups;
+    }
+};
+
+// exact, by calling the system with Dual numbers (it must be a template)
+struct AutoDiff
+{
+    template <class System, class Linear, std::size_t N>
+    static int evaluate(System &system, double t, const std::array<double, N> &y,
+                        const std::array<double, N> &, Linear &solver)
+    {
+        const int n = int(N), groups = std::min(n, int(Linear::lower) + int(Linear::upper) + 1);
+        std::array<Dual, N> yd, fd;
+        for (int j = 0; j < n; ++j) yd[j] = Dual(y[j], 0.0);
+
+        for (int g = 0; g < groups; ++g)
+        {
+            for (int j = g; j < n; j += groups) yd[j].d = 1.0;
+            system(t, yd, fd);
+
+            for (int j = g; j < n; j += groups)
+            {
+                for (int i = std::max(0, j - int(Linear::upper)); i <= std::min(n - 1, j + int(Linear::lower)); ++i)
+                    solver.setJacobian(i, j, fd[i].d);
+                yd[j].d = 0.0;
+            }
+        }
+        return groups;
+    }
+};
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef LINEAR_H
+#define LINEAR_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+/* Solvers for the linear systems (I - c J) x = b of the implicit
+   integrators (see stiff.h), for N equations. Each keeps the Jacobian J
+   and the LU factors of I - c J separately, so the factors can be
+   redone for a new c (a new step size) without working out J again,
+   and both are reused for as long as the integrator likes. All the
+   storage is made with the solver, so nothing is allocated while
+   stepping.
+
+   They differ in which entries of J they hold: J(i, j) may be non zero
+   for j - upper <= i <= j + lower, and the Jacobian is only worked out
+   for those (see jacobian.h), which for a banded J takes lower + upper
+   + 1 calls to the system rather than N.
+
+   - DenseLU: any J, LU with partial pivoting, O(N^3) to factor,
+   - BandedLU: J with lower / upper diagonals (e.g. a 1D grid with a
+     wider stencil, or several variables per point), LU without
+     pivoting (I - c J is diagonally dominant for the usual stiff
+     problems), O(N lower upper),
+   - Tridiagonal: the Thomas algorithm, O(N).
+*/
+template <int N>
+class DenseLU
+{
+    public:
+        enum { lower = N - 1, upper = N - 1 };
+
+        DenseLU() : J(std::size_t(N) * N, 0.0), LU(std::size_t(N) * N), pivot(N) {}
+
+        void setJacobian(int i, int j, double value) { J[std::size_t(i) * N + j] = value; }
+
+        void factor(double c)
+        {
+            for (int i = 0; i < N; ++i)
+                for (int j = 0; j < N; ++j)
+                    LU[std::size_t(i) * N + j] = (i == j) - c * J[std::size_t(i) * N + j];
+
+            for (int k = 0; k < N; ++k)
+            {
+                int p = k;
+                for (int i = k + 1; i < N; ++i)
+                    if (std::fabs(at(i, k)) > std::fabs(at(p, k))) p = i;
+                pivot[k] = p;
+                if (p != k)
+                    for (int j = 0; j < N; ++j) std::swap(at(k, j), at(p, j));
+
+                const double inv = 1.0 / at(k, k);
+                for (int i = k + 1; i < N; ++i)
+                {
+                    const double l = (at(i, k) *= inv);
+                    double *row = &LU[std::size_t(i) * N], *top = &LU[std::size_t(k) * N];
+                    for (int j = k + 1; j < N; ++j) row[j] -= l * top[j];
+                }
+            }
+        }
+
+        // b = (I - c J)^-1 b
+        void solve(double *b) const
+        {
+            // the rows were swapped whole (multipliers too), so swap b first
+            for (int k = 0; k < N; ++k) std::swap(b[k], b[pivot[k]]);
+            for (int k = 0; k < N; ++k)
+                for (int i = k + 1; i < N; ++i) b[i] -= at(i, k) * b[k];
+            for (int i = N - 1; i >= 0; --i)
+            {
+                double sum = b[i];
+                for (int j = i + 1; j < N; ++j) sum -= at(i, j) * b[j];
+                b[i] = sum / at(i, i);
+            }
+        }
+
+    private:
+        std::vector<double> J, LU;
+        std::vector<int> pivot;
+
+        double &at(int i, int j) { return LU[std::size_t(i) * N + j]; }
+        double at(int i, int j) const { return LU[std::size_t(i) * N + j]; }
+};
+
+
+// band storage: row i keeps columns i - KL .. i + KU
+template <int N, int KL, int KU>
+class BandedLU
+{
+    public:
+        enum { lower = KL, upper = KU, width = KL + KU + 1 };
+
+        BandedLU() : J(std::size_t(N) * width, 0.0), LU(std::size_t(N) * width) {}
+
+        void setJacobian(int i, int j, double value) { J[std::size_t(i) * width + j - i + KL] = value; }
+
+        void factor(double c)
+        {
+            for (int i = 0; i < N; ++i)
+                for (int d = 0; d < width; ++d)
+                    LU[std::size_t(i) * width + d] = (d == KL) - c * J[std::size_t(i) * width + d];
+
+            for (int k = 0; k < N; ++k)
+            {
+                const double inv = 1.0 / at(k, k);
+                for (int i = k + 1; i <= std::min(N - 1, k + KL); ++i)
+                {
+                    const double l = (at(i, k) *= inv);
+                    for (int j = k + 1; j <= std::min(N - 1, k + KU); ++j) at(i, j) -= l * at(k, j);
+                }
+            }
+        }
+
+        void solve(double *b) const
+        {
+            for (int i = 0; i < N; ++i)
+                for (int j = std::max(0, i - KL); j < i; ++j) b[i] -= at(i, j) * b[j];
+            for (int i = N - 1; i >= 0; --i)
+            {
+                double sum = b[i];
+                for (int j = i + 1; j <= std::min(N - 1, i + KU); ++j) sum -= at(i, j) * b[j];
+                b[i] = sum / at(i, i);
+            }
+        }
+
+    private:
+        std::vector<double> J, LU;
+
+        double &at(int i, int j) { return LU[std::size_t(i) * width + j - i + KL]; }
+        double at(int i, int j) const { return LU[std::size_t(i) * width + j - i + KL]; }
+};
+
+
+template <int N>
+class Tridiagonal
+{
+    public:
+        enum { lower = 1, upper = 1 };
+
+        Tridiagonal() : a(N, 0.0), b(N, 0.0), c(N, 0.0), l(N), d(N), u(N) {}
+
+        // a below the diagonal, b on it, c above
+        void setJacobian(int i, int j, double value)
+        {
+            if (j == i - 1) a[i] = value;
+            else if (j == i) b[i] = value;
+            else c[i] = value;
+        }
+
+        // forward elimination, keeping the multipliers l and the pivots d
+        void factor(double s)
+        {
+            d[0] = 1 - s * b[0];
+            for (int i = 0; i < N; ++i) u[i] = -s * c[i];
+            for (int i = 1; i < N; ++i)
+            {
+                l[i] = -s * a[i] / d[i - 1];
+                d[i] = 1 - s * b[i] - l[i] * u[i - 1];
+            }
+        }
+
+        void solve(double *x) const
+        {
+            for (int i = 1; i < N; ++i) x[i] -= l[i] * x[i - 1];
+            x[N - 1] /= d[N - 1];
+            for (int i = N - 2; i >= 0; --i) x[i] = (x[i] - u[i] * x[i + 1]) / d[i];
+        }
+
+    private:
+        std::vector<double> a, b, c;        // J
+        std::vector<double> l, d, u;        // its factors
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef MAP_H
+#define MAP_H
+
+#include "state.h"
+
+/* Iterated map, y_{n+1} = F(y_n), behind the same interface as the ODE
+   steppers, so that maps (e.g. the logistic map) can be run by the
+   same drivers (see ensemble.h). The system is called as
+
+       system(t, y, next)
+
+   to set next to the image of y; t counts the iterations (t = n h) and
+   h plays no other part.
+*/
+template <class System, class State>
+class MapStepper
+{
+    public:
+        explicit MapStepper(System &system) : system(system), calls(0) {}
+
+        void step(State &y, double t, double)
+        {
+            system(t, y, next);
+            y = next;
+            ++calls;
+        }
+
+        long evaluations() const { return calls; }
+
+    private:
+        System &system;
+        State next;
+        long calls;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef RK4_H
+#define RK4_H
+
+#include "state.h"
+
+/* The classical fourth order Runge-Kutta method.
+
+   A stepper is built for one system and one type of state (see
+   state.h), and is then used for every step. The system is any object
+   that can be called as
+
+       system(t, y, dydt)
+
+   to set dydt to the derivative of the whole state y at time t, so each
+   stage costs exactly one call, however many equations there are. The
+   stages and the intermediate state are members of the stepper, so
+   stepping never allocates.
+*/
+template <class System, class State>
+class RK4Stepper
+{
+    public:
+        explicit RK4Stepper(System &system) : system(system), calls(0) {}
+
+        static int order() { return 4; }
+
+        // advance y from t to t + h
+        void step(State &y, double t, double h)
+        {
+            static const double a2[] = { 0.5 }, a3[] = { 0.0, 0.5 }, a4[] = { 0.0, 0.0, 1.0 };
+            static const double b[] = { 1 / 6.0, 1 / 3.0, 1 / 3.0, 1 / 6.0 };
+
+            system(t, y, k[0]);
+            StateOps<State>::combine(temp, y, h, a2, k, 1);
+            system(t + 0.5 * h, temp, k[1]);
+            StateOps<State>::combine(temp, y, h, a3, k, 2);
+            system(t + 0.5 * h, temp, k[2]);
+            StateOps<State>::combine(temp, y, h, a4, k, 3);
+            system(t + h, temp, k[3]);
+
+            StateOps<State>::combine(y, y, h, b, k, 4);
+            calls += 4;
+        }
+
+        // number of calls to the system so far
+        long evaluations() const { return calls; }
+
+    private:
+        System &system;
+        State k[4], temp;
+        long calls;
+};
+
+#endif
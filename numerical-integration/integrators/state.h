@@ -0,0 +1,132 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include <array>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+/* The state of an ODE system is any type that StateOps knows how to
+   combine. The choice is made at compile time, so the integrators work
+   on the state directly, with no virtual calls and no heap:
+
+   - double, for a single equation,
+   - the SIMD vector types below, which hold one variable for several
+     independent systems (e.g. the same equation from different
+     starting points) and are stepped together, one system per lane,
+   - std::array<T, N> of either, for a system of N equations, whose
+     size is fixed at compile time so small systems stay in registers.
+
+   The only operation the explicit integrators need is
+
+       out = y + h (b_0 k_0 + b_1 k_1 + ... + b_{s-1} k_{s-1})
+
+   which covers every stage and the final update of a Runge-Kutta step.
+   out may be the same object as y, but not as any of the k. The
+   adaptive integrators also need the size of an error estimate
+   h (e_0 k_0 + ...) relative to the tolerances, which is
+
+       max |error_n| / (atol + rtol max(|y0_n|, |y1_n|))
+
+   over every variable n (and every lane), so a step is only accepted
+   if it is good enough for all the systems stepped together.
+*/
+
+// gcc / clang vector extensions; without the matching instruction set
+// the compiler splits them into smaller vectors, so they always work
+typedef double Vec2 __attribute__ ((vector_size (2 * sizeof(double))));
+typedef double Vec4 __attribute__ ((vector_size (4 * sizeof(double))));
+typedef double Vec8 __attribute__ ((vector_size (8 * sizeof(double))));
+
+
+// one variable's (or lane's) error, relative to the tolerance
+inline double scaledError(double e, double y0, double y1, double atol, double rtol)
+{
+    return std::fabs(e) / (atol + rtol * std::max(std::fabs(y0), std::fabs(y1)));
+}
+
+template <class V>
+inline double laneError(const V &e, const V &y0, const V &y1, double atol, double rtol)
+{
+    double worst = 0.0;
+    for (std::size_t l = 0; l < sizeof(V) / sizeof(double); ++l)
+        worst = std::max(worst, scaledError(e[l], y0[l], y1[l], atol, rtol));
+    return worst;
+}
+
+inline double scaledError(const Vec2 &e, const Vec2 &y0, const Vec2 &y1, double atol, double rtol)
+{
+    return laneError(e, y0, y1, atol, rtol);
+}
+
+inline double scaledError(const Vec4 &e, const Vec4 &y0, const Vec4 &y1, double atol, double rtol)
+{
+    return laneError(e, y0, y1, atol, rtol);
+}
+
+inline double scaledError(const Vec8 &e, const Vec8 &y0, const Vec8 &y1, double atol, double rtol)
+{
+    return laneError(e, y0, y1, atol, rtol);
+}
+
+
+/* double and the vector types: the arithmetic operators already do the
+   right thing (a vector times a double multiplies every lane)
+*/
+template <class State>
+struct StateOps
+{
+    static void combine(State &out, const State &y, double h, const double *b, const State *k, int s)
+    {
+        State sum = b[0] * k[0];
+        for (int i = 1; i < s; ++i)
+            if (b[i] != 0.0) sum += b[i] * k[i];
+        out = y + h * sum;
+    }
+
+    static double error(const State &y0, const State &y1, double h, const double *e, const State *k, int s,
+                        double atol, double rtol)
+    {
+        State sum = e[0] * k[0];
+        for (int i = 1; i < s; ++i)
+            if (e[i] != 0.0) sum += e[i] * k[i];
+        return scaledError(h * sum, y0, y1, atol, rtol);
+    }
+};
+
+
+/* fixed size arrays, element by element (the elements being doubles or
+   vectors); N is known at compile time, so the loops unroll
+*/
+template <class T, std::size_t N>
+struct StateOps<std::array<T, N> >
+{
+    typedef std::array<T, N> State;
+
+    static void combine(State &out, const State &y, double h, const double *b, const State *k, int s)
+    {
+        for (std::size_t n = 0; n < N; ++n)
+        {
+            T sum = b[0] * k[0][n];
+            for (int i = 1; i < s; ++i)
+                if (b[i] != 0.0) sum += b[i] * k[i][n];
+            out[n] = y[n] + h * sum;
+        }
+    }
+
+    static double error(const State &y0, const State &y1, double h, const double *e, const State *k, int s,
+                        double atol, double rtol)
+    {
+        double worst = 0.0;
+        for (std::size_t n = 0; n < N; ++n)
+        {
+            T sum = e[0] * k[0][n];
+            for (int i = 1; i < s; ++i)
+                if (e[i] != 0.0) sum += e[i] * k[i][n];
+            worst = std::max(worst, scaledError(h * sum, y0[n], y1[n], atol, rtol));
+        }
+        return worst;
+    }
+};
+
+#endif
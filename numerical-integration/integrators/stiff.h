@@ -0,0 +1,410 @@
+#ifndef STIFF_H
+#define STIFF_H
+
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+#include "linear.h"
+#include "jacobian.h"
+
+/* Integrators for stiff systems: those with some modes decaying much
+   faster than the solution changes (e.g. diffusion on a fine grid),
+   for which an explicit method has to take steps short enough to
+   follow the fastest mode, long after it has died away. These are all
+   implicit (or linearly implicit), and stable for any step on decaying
+   modes, so the step only has to follow the solution itself.
+
+   Each step needs solutions of (I - c J) x = b, with J = df/dy. J is
+   worked out by a Jacobian method of jacobian.h (FiniteDifference or
+   AutoDiff) into a linear solver of linear.h (DenseLU, BandedLU,
+   Tridiagonal), which also keeps the LU factors of I - c J. Both are
+   costly, and both are reused for as long as possible: J is only
+   worked out again when it is max_age steps old or the step runs into
+   trouble, and the factors only when c (i.e. the step size) changes.
+
+   The system is called as system(t, y, dydt), as for the explicit
+   steppers, on std::array<double, N> states (and on std::array<Dual, N>
+   as well for AutoDiff, so it must then be a template).
+*/
+
+
+// max |x_i| / (atol + rtol |y_i|), the size of a correction relative to the tolerance
+template <std::size_t N>
+inline double scaledNorm(const std::array<double, N> &x, const std::array<double, N> &y, double atol, double rtol)
+{
+    double worst = 0.0;
+    for (std::size_t i = 0; i < N; ++i)
+        worst = std::max(worst, std::fabs(x[i]) / (atol + rtol * std::fabs(y[i])));
+    return worst;
+}
+
+
+/* The Jacobian, the linear solver and the counts, shared by all the
+   stiff integrators
+*/
+template <class System, int N, class Linear, class Jacobian>
+class ImplicitBase
+{
+    public:
+        typedef std::array<double, N> State;
+
+        ImplicitBase(System &system, double atol, double rtol, int max_age)
+            : system(system), atol(atol), rtol(rtol), max_age(max_age),
+              age(-1), factored(0.0), calls(0), jacobian_count(0), factor_count(0) {}
+
+        // calls to the system (including for the Jacobian), Jacobians, LU factorisations
+        long evaluations() const { return calls; }
+        long jacobians() const { return jacobian_count; }
+        long factorisations() const { return factor_count; }
+
+    protected:
+        System &system;
+        double atol, rtol;
+        int max_age;
+
+        Linear solver;
+        int age;                // steps since J was worked out (-1: never)
+        double factored;        // the c of the current factors (0: none)
+        long calls, jacobian_count, factor_count;
+
+        void f(double t, const State &y, State &dydt)
+        {
+            system(t, y, dydt);
+            ++calls;
+        }
+
+        // work out J at (t, y), with fy = f(t, y)
+        void jacobian(double t, const State &y, const State &fy)
+        {
+            calls += Jacobian::evaluate(system, t, y, fy, solver);
+            ++jacobian_count;
+            age = 0;
+            factored = 0.0;
+        }
+
+        // make sure the factors are for I - c J
+        void factor(double c)
+        {
+            if (c == factored) return;
+            solver.factor(c);
+            factored = c;
+            ++factor_count;
+        }
+
+        /* Solve z = r + c f(t_f, w), w = sigma z + (1 - sigma) base, for z
+           (starting from the guess in z) by Newton's method with the
+           stored J, which is refreshed (once) if it doesn't converge.
+        */
+        bool newton(State &z, const State &r, double c, double sigma, const State &base, double t_f)
+        {
+            if (age < 0 || age >= max_age) fresh(z, sigma, base, t_f);
+            const State guess(z);
+
+            for (int attempt = 0; attempt < 2; ++attempt)
+            {
+                factor(c * sigma);
+                double previous = HUGE_VAL;
+
+                for (int iter = 0; iter < 10; ++iter)
+                {
+                    for (int i = 0; i < N; ++i) w[i] = sigma * z[i] + (1 - sigma) * base[i];
+                    f(t_f, w, fw);
+                    for (int i = 0; i < N; ++i) delta[i] = r[i] + c * fw[i] - z[i];
+                    solver.solve(&delta[0]);
+                    for (int i = 0; i < N; ++i) z[i] += delta[i];
+
+                    const double size = scaledNorm(delta, z, atol, rtol);
+                    if (size < 0.03) return true;
+
+                    // give up if it has stopped getting closer
+                    if (size > 0.9 * previous || !(size < HUGE_VAL)) break;
+                    previous = size;
+                }
+
+                // try again with a new J, unless it was new already
+                if (age == 0) return false;
+                z = guess;
+                fresh(z, sigma, base, t_f);
+            }
+            return false;
+        }
+
+    private:
+        State w, fw, delta;
+
+        void fresh(const State &z, double sigma, const State &base, double t_f)
+        {
+            for (int i = 0; i < N; ++i) w[i] = sigma * z[i] + (1 - sigma) * base[i];
+            f(t_f, w, fw);
+            jacobian(t_f, w, fw);
+        }
+};
+
+
+/* Rosenbrock-W method ROS2 (Verwer, Spee, Blom & Hundsdorfer, 1999):
+
+       (I - gamma h J) k1 = f(t, y)
+       (I - gamma h J) k2 = f(t + h, y + h k1) - 2 k1
+       y_new = y + 3/2 h k1 + 1/2 h k2,    gamma = 1 + 1 / sqrt(2)
+
+   Linearly implicit, so each step is two solves with the same factors
+   and no Newton iterations. Being a W-method, it keeps its second
+   order whatever J is used, so J can be kept for many steps. The step
+   size is adaptive, from the difference with the first order solution
+   y + h k1, with the same interface as EmbeddedStepper; the step is
+   only changed when that is worth refactoring for.
+*/
+template <class System, int N, class Linear = DenseLU<N>, class Jacobian = FiniteDifference>
+class RosenbrockW : public ImplicitBase<System, N, Linear, Jacobian>
+{
+    typedef ImplicitBase<System, N, Linear, Jacobian> Base;
+
+    public:
+        typedef typename Base::State State;
+
+        RosenbrockW(System &system, double atol, double rtol, int max_age = 20)
+            : Base(system, atol, rtol, max_age), t(0.0), h(0.0), accepted(0), rejected(0) {}
+
+        static int order() { return 2; }
+
+        void reset(double t_start, const State &y_start, double h_first)
+        {
+            t = t_start;
+            y = y_start;
+            h = h_first;
+            this->age = -1;
+        }
+
+        // one step (retrying until good enough), but not past t_end
+        bool step(double t_end)
+        {
+            const double gamma = 1 + 1 / std::sqrt(2.0);
+            const double h_min = 16 * std::fabs(t) * 2.2e-16;
+
+            this->f(t, y, f0);
+            if (this->age < 0 || this->age >= this->max_age) this->jacobian(t, y, f0);
+
+            for (bool retry = false; ; retry = true)
+            {
+                double hs = (t + 1.01 * h >= t_end) ? t_end - t : h;
+                if (hs <= h_min) return false;
+
+                this->factor(gamma * hs);
+
+                k1 = f0;
+                this->solver.solve(&k1[0]);
+                for (int i = 0; i < N; ++i) temp[i] = y[i] + hs * k1[i];
+                this->f(t + hs, temp, k2);
+                for (int i = 0; i < N; ++i) k2[i] -= 2 * k1[i];
+                this->solver.solve(&k2[0]);
+
+                // error: the difference from y + h k1, relative to atol + rtol |y|
+                double err = 0.0;
+                for (int i = 0; i < N; ++i)
+                {
+                    y_new[i] = y[i] + 1.5 * hs * k1[i] + 0.5 * hs * k2[i];
+                    const double scale = this->atol + this->rtol * std::max(std::fabs(y[i]), std::fabs(y_new[i]));
+                    err = std::max(err, std::fabs(0.5 * hs * (k1[i] + k2[i])) / scale);
+                }
+
+                double factor = (err == 0.0) ? 5.0 : 0.9 / std::sqrt(err);
+                factor = std::min(5.0, std::max(0.2, factor));
+
+                if (err <= 1.0)
+                {
+                    t += hs;
+                    y = y_new;
+                    ++this->age;
+                    ++accepted;
+
+                    // keep the step (and the factors) unless it can grow by a good deal
+                    if (retry) factor = std::min(factor, 1.0);
+                    if (factor > 1.5 || factor < 1.0) h = hs * factor;
+                    else h = hs;
+                    return true;
+                }
+
+                // a new J may be all it needs
+                ++rejected;
+                h = hs * factor;
+                if (this->age > 0) this->jacobian(t, y, f0);
+            }
+        }
+
+        double time() const { return t; }
+        const State &state() const { return y; }
+        double stepSize() const { return h; }
+        long acceptedSteps() const { return accepted; }
+        long rejectedSteps() const { return rejected; }
+
+    private:
+        double t, h;
+        State y, y_new, f0, k1, k2, temp;
+        long accepted, rejected;
+};
+
+
+/* Backward differentiation formulae of order 1 to 5, at a fixed step h:
+
+       y_n+1 = a_1 y_n + ... + a_k y_n+1-k + h beta f(t_n+1, y_n+1)
+
+   solved for y_n+1 by Newton's method, with the factors of I - h beta J
+   reused from step to step (h being fixed, they only change with J).
+
+   Until there are k past values, the steps are taken by extrapolating
+   implicit Euler over 1, 2, ..., k substeps (as in Deuflhard's SEULEX),
+   which is of order k and damps stiff modes just as well. Starting with
+   the lower order formulae instead would leave the error of the first
+   step, O(h^2), in the solution for good. The past values are forgotten
+   (and the start repeated) if h changes, or on reset().
+*/
+template <class System, int N, class Linear = DenseLU<N>, class Jacobian = FiniteDifference>
+class BDF : public ImplicitBase<System, N, Linear, Jacobian>
+{
+    typedef ImplicitBase<System, N, Linear, Jacobian> Base;
+
+    public:
+        typedef typename Base::State State;
+
+        BDF(System &system, int order, double atol, double rtol, int max_age = 20)
+            : Base(system, atol, rtol, max_age), max_order(std::min(std::max(order, 1), 5)), count(0), h_last(0.0) {}
+
+        int order() const { return max_order; }
+
+        void reset() { count = 0; }
+
+        // advance y from t to t + h; false if the Newton iterations failed
+        bool step(State &y, double t, double h)
+        {
+            static const double a[5][5] = {
+                { 1.0 },
+                { 4 / 3.0, -1 / 3.0 },
+                { 18 / 11.0, -9 / 11.0, 2 / 11.0 },
+                { 48 / 25.0, -36 / 25.0, 16 / 25.0, -3 / 25.0 },
+                { 300 / 137.0, -300 / 137.0, 200 / 137.0, -75 / 137.0, 12 / 137.0 }
+            };
+            static const double beta[5] = { 1.0, 2 / 3.0, 6 / 11.0, 12 / 25.0, 60 / 137.0 };
+
+            // past values: past[0] = y_n, past[1] = y_n-1, ...
+            if (h != h_last) count = 0;
+            h_last = h;
+            for (int j = std::min(count, max_order - 1); j > 0; --j) past[j] = past[j - 1];
+            past[0] = y;
+            count = std::min(count + 1, max_order);
+            const int k = max_order;
+
+            bool ok;
+            if (count < k) ok = start(y, t, h);
+            else
+            {
+                // the known part of the formula, and an extrapolated first guess
+                for (int i = 0; i < N; ++i)
+                {
+                    double sum = 0.0, guess = 0.0;
+                    for (int j = 0; j < k; ++j)
+                    {
+                        sum += a[k - 1][j] * past[j][i];
+                        guess += extrapolate(k, j) * past[j][i];
+                    }
+                    r[i] = sum;
+                    y[i] = guess;
+                }
+                ok = this->newton(y, r, beta[k - 1] * h, 1.0, r, t + h);
+            }
+
+            ++this->age;
+            if (!ok) { y = past[0]; count = 0; }
+            return ok;
+        }
+
+    private:
+        int max_order, count;
+        double h_last;
+        State past[5], r, table[5];
+
+        // a step of order max_order from y alone, extrapolating implicit Euler
+        bool start(State &y, double t, double h)
+        {
+            const int k = max_order;
+            for (int j = 0; j < k; ++j)
+            {
+                // j + 1 implicit Euler steps of h / (j + 1)
+                const double hs = h / (j + 1);
+                table[j] = y;
+                for (int s = 0; s <= j; ++s)
+                {
+                    r = table[j];
+                    if (!this->newton(table[j], r, hs, 1.0, r, t + (s + 1) * hs)) return false;
+                }
+            }
+
+            // Aitken-Neville, for an error expansion in powers of h
+            for (int l = 1; l < k; ++l)
+                for (int j = k - 1; j >= l; --j)
+                {
+                    const double ratio = double(j + 1) / (j + 1 - l) - 1.0;
+                    for (int i = 0; i < N; ++i) table[j][i] += (table[j][i] - table[j - 1][i]) / ratio;
+                }
+
+            y = table[k - 1];
+            return true;
+        }
+
+        // the polynomial through the last k values (up to 3, beyond which
+        // it is as likely to hurt as help), at the next point
+        static double extrapolate(int k, int j)
+        {
+            static const double c[3][3] = { { 1.0 }, { 2.0, -1.0 }, { 3.0, -3.0, 1.0 } };
+            const int m = std::min(k, 3);
+            return (j < m) ? c[m - 1][j] : 0.0;
+        }
+};
+
+
+/* Implicit midpoint rule,
+
+       y_n+1 = y_n + h f(t_n + h / 2, (y_n + y_n+1) / 2)
+
+   second order, A-stable and symplectic (so it conserves quadratic
+   invariants and suits oscillatory problems, where BDF damps), solved
+   by Newton's method with the factors of I - h / 2 J reused as for BDF.
+*/
+template <class System, int N, class Linear = DenseLU<N>, class Jacobian = FiniteDifference>
+class ImplicitMidpoint : public ImplicitBase<System, N, Linear, Jacobian>
+{
+    typedef ImplicitBase<System, N, Linear, Jacobian> Base;
+
+    public:
+        typedef typename Base::State State;
+
+        ImplicitMidpoint(System &system, double atol, double rtol, int max_age = 20)
+            : Base(system, atol, rtol, max_age), have_last(false), h_last(0.0) {}
+
+        static int order() { return 2; }
+
+        void reset() { have_last = false; }
+
+        bool step(State &y, double t, double h)
+        {
+            // first guess: carry on as the last step went
+            State z(y);
+            if (have_last && h == h_last)
+                for (int i = 0; i < N; ++i) z[i] = 2 * y[i] - last[i];
+
+            last = y;
+            const bool ok = this->newton(z, last, h, 0.5, last, t + 0.5 * h);
+            ++this->age;
+            if (ok) y = z;
+            have_last = ok;
+            h_last = h;
+            return ok;
+        }
+
+    private:
+        bool have_last;
+        double h_last;
+        State last;
+};
+
+#endif
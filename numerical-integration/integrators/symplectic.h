@@ -0,0 +1,96 @@
+#ifndef SYMPLECTIC_H
+#define SYMPLECTIC_H
+
+/* Symplectic integrators for separable Hamiltonian systems (positions
+   x, velocities v, forces depending only on x), as compositions of
+   "kicks" v += c h a(x) and "drifts" x += d h v.
+
+   Unlike the Runge-Kutta methods these conserve a nearby energy
+   exactly, so the energy error stays bounded (it oscillates, rather
+   than drifting away) however many steps are taken, and much longer
+   steps can be used over long runs.
+
+   A scheme lists the kick and drift of each of its substeps (kick
+   first); a zero means that part is left out.
+*/
+
+// velocity Verlet / leapfrog (kick-drift-kick), second order
+struct Verlet
+{
+    enum { substeps = 2, order = 2 };
+
+    static constexpr double kick[substeps] = { 0.5, 0.5 };
+    static constexpr double drift[substeps] = { 1.0, 0.0 };
+};
+
+// Yoshida (1990): three leapfrogs of w1 h, w0 h and w1 h, with
+// w1 = 1 / (2 - 2^(1/3)), w0 = 1 - 2 w1; fourth order
+struct Yoshida4
+{
+    enum { substeps = 4, order = 4 };
+
+    static constexpr double w1 = 1.3512071919596578, w0 = -1.7024143839193153;
+    static constexpr double kick[substeps] = { 0.5 * w1, 0.5 * (w0 + w1), 0.5 * (w0 + w1), 0.5 * w1 };
+    static constexpr double drift[substeps] = { w1, w0, w1, 0.0 };
+};
+
+
+/* Stepper for a scheme above. The system provides
+
+       system.forces(y)        to work out the accelerations at the
+                               positions of y (and keep them in y),
+       system.kick(y, dt)      to add dt times them to the velocities,
+       system.drift(y, dt)     to add dt times the velocities to the
+                               positions,
+
+   and, as for the other steppers, y can be anything the system knows
+   how to handle. The forces are only recalculated after a drift, so
+   the last kick of one step and the first of the next share them, and
+   the force calculation (by far the costliest part) is done once per
+   step for Verlet and three times for Yoshida4. This relies on y not
+   being changed between steps; call reset() if it is.
+*/
+template <class System, class State, class Scheme = Verlet>
+class SymplecticStepper
+{
+    public:
+        explicit SymplecticStepper(System &system) : system(system), current(false), calls(0) {}
+
+        static int order() { return Scheme::order; }
+
+        // forget the forces, e.g. after changing the state from outside
+        void reset() { current = false; }
+
+        // advance y from t to t + h
+        void step(State &y, double, double h)
+        {
+            for (int s = 0; s < Scheme::substeps; ++s)
+            {
+                if (Scheme::kick[s] != 0.0)
+                {
+                    if (!current)
+                    {
+                        system.forces(y);
+                        current = true;
+                        ++calls;
+                    }
+                    system.kick(y, Scheme::kick[s] * h);
+                }
+                if (Scheme::drift[s] != 0.0)
+                {
+                    system.drift(y, Scheme::drift[s] * h);
+                    current = false;
+                }
+            }
+        }
+
+        // number of force calculations so far
+        long evaluations() const { return calls; }
+
+    private:
+        System &system;
+        bool current;
+        long calls;
+};
+
+#endif
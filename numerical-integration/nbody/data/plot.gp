@@ -0,0 +1,5 @@
+set title "N-body: relative energy error"
+set xlabel "time (t)"
+set ylabel "(E - E_0) / |E_0|"
+set key off
+plot "energy.dat" using 1:5 with lines
@@ -0,0 +1,205 @@
+/*
+   Gravitational N-body problem
+
+   Particles move under their mutual gravity (G = 1), stepped by a
+   symplectic integrator (../integrators/symplectic.h), which keeps the
+   energy error bounded over long runs instead of letting it drift as
+   RK4 does. The forces are either summed directly over all pairs
+   (utilities/direct.h) or approximated by a Barnes-Hut tree
+   (utilities/barneshut.h); the energy and momentum are worked out along
+   the way and written to data/energy.dat as the run goes.
+*/
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <omp.h>
+
+#include "symplectic.h"
+#include "utilities/particles.h"
+#include "utilities/direct.h"
+#include "utilities/barneshut.h"
+
+using std::cout;
+using std::endl;
+
+// starting positions: the three body figure of eight (Chenciner &
+// Montgomery, 2000), or a Plummer sphere of n stars
+enum Setup { FIGURE_EIGHT, PLUMMER };
+
+// which symplectic scheme to use
+enum Scheme { VERLET, YOSHIDA4 };
+
+// how the forces are worked out
+enum Engine { DIRECT, BARNES_HUT };
+
+/* Plummer model in N-body units (total mass 1, energy -1/4), sampled
+   as in Aarseth, Henon & Wielen (1974), and moved to its centre of mass
+*/
+void plummer(Particles &p, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    const int n = p.size();
+    const double scale = 3 * M_PI / 16;
+
+    // a random direction, times a length
+    auto direction = [&](double length, double &x, double &y, double &z)
+    {
+        const double cos_theta = 2 * uniform(rng) - 1, phi = 2 * M_PI * uniform(rng);
+        const double sin_theta = std::sqrt(1 - cos_theta * cos_theta);
+        x = length * sin_theta * std::cos(phi);
+        y = length * sin_theta * std::sin(phi);
+        z = length * cos_theta;
+    };
+
+    double cm[6] = { 0, 0, 0, 0, 0, 0 };
+    for (int i = 0; i < n; ++i)
+    {
+        double r;
+        do r = 1.0 / std::sqrt(std::pow(uniform(rng), -2.0 / 3.0) - 1.0); while (r > 20);
+        direction(r * scale, p.x[i], p.y[i], p.z[i]);
+
+        // speed, as a fraction q of the escape speed, by rejection from q^2 (1 - q^2)^(7/2)
+        double q;
+        do q = uniform(rng); while (0.1 * uniform(rng) > q * q * std::pow(1 - q * q, 3.5));
+        const double v = q * std::sqrt(2.0) * std::pow(1 + r * r, -0.25);
+        direction(v / std::sqrt(scale), p.vx[i], p.vy[i], p.vz[i]);
+
+        p.m[i] = 1.0 / n;
+        cm[0] += p.x[i]; cm[1] += p.y[i]; cm[2] += p.z[i];
+        cm[3] += p.vx[i]; cm[4] += p.vy[i]; cm[5] += p.vz[i];
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        p.x[i] -= cm[0] / n; p.y[i] -= cm[1] / n; p.z[i] -= cm[2] / n;
+        p.vx[i] -= cm[3] / n; p.vy[i] -= cm[4] / n; p.vz[i] -= cm[5] / n;
+    }
+}
+
+void figureEight(Particles &p)
+{
+    const double x1 = 0.97000436, y1 = -0.24308753, vx3 = -0.93240737, vy3 = -0.86473146;
+    const double x[3] = { x1, -x1, 0.0 }, y[3] = { y1, -y1, 0.0 };
+    const double vx[3] = { -0.5 * vx3, -0.5 * vx3, vx3 }, vy[3] = { -0.5 * vy3, -0.5 * vy3, vy3 };
+
+    for (int i = 0; i < 3; ++i)
+    {
+        p.x[i] = x[i]; p.y[i] = y[i]; p.z[i] = 0.0;
+        p.vx[i] = vx[i]; p.vy[i] = vy[i]; p.vz[i] = 0.0;
+        p.m[i] = 1.0;
+    }
+}
+
+/* Compare the accelerations from the tree with the direct sum; returns
+   the rms error, relative to the rms acceleration (relative errors of
+   single particles can be large where the forces nearly cancel)
+*/
+double treeError(Particles &p, BarnesHut &tree, const DirectSum &direct)
+{
+    const int n = p.size();
+    tree.accelerations(p);
+    std::vector<double> ax(p.ax), ay(p.ay), az(p.az);
+    direct.accelerations(p);
+
+    double error = 0.0, size = 0.0;
+    for (int i = 0; i < n; ++i)
+    {
+        const double ex = ax[i] - p.ax[i], ey = ay[i] - p.ay[i], ez = az[i] - p.az[i];
+        error += ex * ex + ey * ey + ez * ez;
+        size += p.ax[i] * p.ax[i] + p.ay[i] * p.ay[i] + p.az[i] * p.az[i];
+    }
+    return std::sqrt(error / size);
+}
+
+template <class Method, class Forces>
+void run(Particles &p, Forces &engine, double h, double t_max, int time_resolution)
+{
+    NBody<Forces> system(engine);
+    SymplecticStepper<NBody<Forces>, Particles, Method> stepper(system);
+
+    const Diagnostics start = system.measure(p);
+    const double E_0 = start.energy();
+    cout << "initial energy " << E_0 << ", momentum " << start.momentum() << endl;
+
+    std::ofstream energyFile("data/energy.dat");
+    energyFile << "# t\tkinetic\tpotential\tenergy\trelative error\tmomentum" << endl;
+
+    const long steps = long(t_max / h + 0.5);
+    double worst = 0.0, wall = omp_get_wtime();
+
+    for (long step = 0; step <= steps; ++step)
+    {
+        if (step > 0) stepper.step(p, (step - 1) * h, h);
+
+        const Diagnostics &d = (step > 0) ? system.diagnostics() : start;
+        const double error = (d.energy() - E_0) / std::fabs(E_0);
+        worst = std::max(worst, std::fabs(error));
+
+        if (step % time_resolution == 0 || step == steps)
+            energyFile << step * h << "\t" << d.kinetic << "\t" << d.potential << "\t"
+                       << d.energy() << "\t" << error << "\t" << d.momentum() << endl;
+    }
+    wall = omp_get_wtime() - wall;
+
+    const Diagnostics &d = system.diagnostics();
+    cout << steps << " steps, " << stepper.evaluations() << " force calculations in " << wall << " s ("
+         << 1e3 * wall / stepper.evaluations() << " ms each)" << endl;
+    cout << "largest relative energy error " << worst << ", final momentum " << d.momentum() << endl;
+}
+
+int main (int, char **)
+{
+
+    int setup = PLUMMER;
+    int n = 2048;                   // number of particles (for PLUMMER)
+    unsigned seed = 1;
+
+    int scheme = YOSHIDA4;
+    double h = 1.0 / 128;           // timestep
+    double t_max = 4.0;             // time to run to
+
+    double eps = 0.01;              // softening length
+
+    // direct sum, O(n^2), or Barnes-Hut tree, O(n log n) (for large n)
+    int engine = DIRECT;
+    int tile = 1024;                // DIRECT: particles per cache tile of the force loop
+    double theta = 0.5;             // BARNES_HUT: opening angle, smaller is more accurate (at most 2 / sqrt(3))
+    int leaf_size = 16;             // BARNES_HUT: most particles in a leaf cell
+    int rebuild_every = 4;          // BARNES_HUT: refit the tree in between rebuilds (1: rebuild every time)
+    bool check = true;              // BARNES_HUT: compare with the direct sum at the start
+
+    int time_resolution = 8;        // don't need to write out every step
+
+
+    if (setup == FIGURE_EIGHT) n = 3;
+    Particles p(n);
+    if (setup == FIGURE_EIGHT) { figureEight(p); eps = 0.0; }
+    else plummer(p, seed);
+
+    cout << n << " particles, " << omp_get_max_threads() << " threads" << endl;
+
+    DirectSum direct(1.0, eps, tile);
+    BarnesHut tree(1.0, eps, theta, leaf_size, rebuild_every);
+
+    if (engine == BARNES_HUT && check)
+        cout << "tree forces: rms relative error " << treeError(p, tree, direct)
+             << " (theta = " << tree.openingAngle() << ", " << tree.cellCount() << " cells)" << endl;
+
+    if (engine == DIRECT && scheme == VERLET) run<Verlet>(p, direct, h, t_max, time_resolution);
+    else if (engine == DIRECT) run<Yoshida4>(p, direct, h, t_max, time_resolution);
+    else if (scheme == VERLET) run<Verlet>(p, tree, h, t_max, time_resolution);
+    else run<Yoshida4>(p, tree, h, t_max, time_resolution);
+
+
+    // final positions
+    std::ofstream outputFile("data/output.dat");
+    outputFile << "# x\ty\tz" << endl;
+    for (int i = 0; i < n; ++i)
+        outputFile << p.x[i] << "\t" << p.y[i] << "\t" << p.z[i] << endl;
+
+    return 0;
+}
@@ -0,0 +1,423 @@
+#ifndef BARNESHUT_H
+#define BARNESHUT_H
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "particles.h"
+#include "direct.h"
+
+/* Barnes-Hut tree code for the gravitational forces, O(n log n): from
+   far enough away a whole group of particles acts like a single mass at
+   its centre of mass. A cell of the tree is used whole if it is further
+   than its size / theta (plus the offset of its centre of mass from the
+   centre of its box, Barnes 1994) from the particle; otherwise its
+   children are tried in turn. theta = 0 gives the direct sum back
+   (slowly); 0.5 - 0.7 gives forces good to a few tenths of a percent.
+   theta is capped at 2 / sqrt(3): any more and a cell could be used
+   whole by a particle inside it (which is at most sqrt(3) / 2 of the
+   size from the centre), which would then feel its own mass.
+
+   The tree is an octree built on Morton (Z order) keys: the bits of the
+   x, y and z cell numbers interleaved, so sorting the particles by key
+   puts every cell of the octree, at every level, into a contiguous run
+   of particles. The particles are kept (in copies) in that order, and
+   the cells are stored in one flat array in depth first order, each
+   with the index of the cell after its subtree (next): the first child
+   of a cell is the cell after it, and a walk over the tree is a single
+   loop over the array which either goes down (i + 1) or skips the
+   subtree (next), with no stack and no pointers.
+
+   Building:
+   - the keys are worked out in parallel, in the order of the last
+     build; the particles have only moved a little since, so they are
+     nearly sorted already, and an insertion sort (linear for nearly
+     sorted data) is used unless too much has changed,
+   - the cells of the top levels are split between threads, which build
+     their subtrees separately, and these are then joined up,
+   - in between full builds (rebuild_every calls) the tree is only
+     refit: the structure is kept and the centres of mass and boxes are
+     worked out again from the new positions, which is much cheaper and,
+     since the opening test uses the true box of each cell's particles,
+     still right (if a little slower to walk as the cells spread out).
+
+   The tree is walked once per leaf cell (of up to leaf_size particles,
+   close together), for all its particles at once, collecting the cells
+   and particles they need into a list, which is then summed for each
+   of them in a loop that vectorises, as in DirectSum. The leaves are
+   shared between threads.
+*/
+class BarnesHut
+{
+    public:
+        BarnesHut(double G, double eps, double theta, int leaf_size = 16, int rebuild_every = 4)
+            : G(G), eps2(eps * eps), theta(std::min(theta, 2 / std::sqrt(3.0))), leaf_size(leaf_size),
+              rebuild_every(std::max(rebuild_every, 1)), calls(0), top_level(2) {}
+
+        // fill in the accelerations, and return the potential energy
+        double accelerations(Particles &p)
+        {
+            if (calls % rebuild_every == 0 || int(order.size()) != p.size()) build(p);
+            else refit(p);
+            ++calls;
+
+            return walk(p);
+        }
+
+        int cellCount() const { return int(cells.size()); }
+        double openingAngle() const { return theta; }
+
+    private:
+        struct Cell
+        {
+            double x, y, z, m;      // centre of mass, mass
+            double open;            // use the cell whole beyond this distance
+            int first, count;       // particles (in key order)
+            int next;               // the cell after this one's subtree
+        };
+
+        struct Key
+        {
+            std::uint64_t key;
+            int index;
+            bool operator<(const Key &other) const { return key < other.key; }
+        };
+
+        // a subtree at top_level, built by one thread
+        struct Chunk
+        {
+            int first, count;
+            std::vector<Cell> cells;
+        };
+
+        double G, eps2, theta;
+        int leaf_size, rebuild_every;
+        long calls;
+        int top_level;
+
+        std::vector<int> order;                     // particle of each sorted position
+        std::vector<Key> keys;
+        std::vector<double> x, y, z, m;             // particles in key order
+        std::vector<Cell> cells;
+        std::vector<Chunk> chunks;
+        std::vector<int> leaves;                    // the leaf cells
+
+        static const int bits = 21;                 // per coordinate, so the key fits 63 bits
+
+        // spread the low 21 bits of v out to every third bit
+        static std::uint64_t spread(std::uint64_t v)
+        {
+            v &= 0x1fffff;
+            v = (v | v << 32) & 0x1f00000000ffffULL;
+            v = (v | v << 16) & 0x1f0000ff0000ffULL;
+            v = (v | v << 8) & 0x100f00f00f00f00fULL;
+            v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+            v = (v | v << 2) & 0x1249249249249249ULL;
+            return v;
+        }
+
+        // the 3 bits of key giving the child at level (the root being level 0)
+        static int octant(std::uint64_t key, int level)
+        {
+            return int(key >> (3 * (bits - 1 - level))) & 7;
+        }
+
+        void build(const Particles &p)
+        {
+            const int n = p.size();
+            if (int(order.size()) != n)
+            {
+                order.resize(n);
+                for (int i = 0; i < n; ++i) order[i] = i;
+                keys.resize(n);
+                x.resize(n); y.resize(n); z.resize(n); m.resize(n);
+            }
+
+            // bounding cube
+            double lo[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL }, hi[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+            const double *px = &p.x[0], *py = &p.y[0], *pz = &p.z[0];
+
+            #pragma omp parallel for reduction(min:lo[:3]) reduction(max:hi[:3])
+            for (int i = 0; i < n; ++i)
+            {
+                lo[0] = std::min(lo[0], px[i]); hi[0] = std::max(hi[0], px[i]);
+                lo[1] = std::min(lo[1], py[i]); hi[1] = std::max(hi[1], py[i]);
+                lo[2] = std::min(lo[2], pz[i]); hi[2] = std::max(hi[2], pz[i]);
+            }
+            const double side = std::max(std::max(hi[0] - lo[0], hi[1] - lo[1]), hi[2] - lo[2]);
+            const double scale = (side > 0) ? ((1 << bits) - 1) / side : 0.0;
+
+            // keys, in the order of the last build
+            #pragma omp parallel for
+            for (int k = 0; k < n; ++k)
+            {
+                const int i = order[k];
+                keys[k].index = i;
+                keys[k].key = spread(std::uint64_t((px[i] - lo[0]) * scale))
+                            | spread(std::uint64_t((py[i] - lo[1]) * scale)) << 1
+                            | spread(std::uint64_t((pz[i] - lo[2]) * scale)) << 2;
+            }
+            long descents = 0;
+            #pragma omp parallel for reduction(+:descents)
+            for (int k = 1; k < n; ++k) descents += (keys[k].key < keys[k - 1].key);
+
+            if (descents < n / 32) insertionSort();
+            else std::sort(keys.begin(), keys.end());
+
+            for (int k = 0; k < n; ++k) order[k] = keys[k].index;
+            gather(p);
+
+            // the subtrees below top_level, in parallel
+            chunks.clear();
+            for (int k = 0; k < n; )
+            {
+                const std::uint64_t prefix = keys[k].key >> (3 * (bits - top_level));
+                int end = k + 1;
+                while (end < n && keys[end].key >> (3 * (bits - top_level)) == prefix) ++end;
+                Chunk c;
+                c.first = k;
+                c.count = end - k;
+                chunks.push_back(c);
+                k = end;
+            }
+
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (int c = 0; c < int(chunks.size()); ++c)
+            {
+                chunks[c].cells.clear();
+                subtree(chunks[c].cells, chunks[c].first, chunks[c].count, top_level);
+            }
+
+            // and the top levels, splicing them in
+            cells.clear();
+            int chunk = 0;
+            if (n > 0) joinTop(0, n, 0, chunk);
+
+            leaves.clear();
+            for (int i = 0; i < int(cells.size()); ++i)
+                if (cells[i].next == i + 1) leaves.push_back(i);
+
+            moments();
+        }
+
+        // sort keys, which are nearly in order already
+        void insertionSort()
+        {
+            for (int k = 1; k < int(keys.size()); ++k)
+            {
+                const Key key = keys[k];
+                int j = k;
+                for (; j > 0 && key.key < keys[j - 1].key; --j) keys[j] = keys[j - 1];
+                keys[j] = key;
+            }
+        }
+
+        // copy the positions and masses into key order
+        void gather(const Particles &p)
+        {
+            const int n = p.size();
+            #pragma omp parallel for
+            for (int k = 0; k < n; ++k)
+            {
+                const int i = order[k];
+                x[k] = p.x[i]; y[k] = p.y[i]; z[k] = p.z[i]; m[k] = p.m[i];
+            }
+        }
+
+        static Cell newCell(int first, int count)
+        {
+            Cell c = { 0, 0, 0, 0, 0, first, count, -1 };
+            return c;
+        }
+
+        // depth first subtree of the particles first .. first + count - 1, all in one cell at level
+        void subtree(std::vector<Cell> &out, int first, int count, int level) const
+        {
+            const int self = int(out.size());
+            out.push_back(newCell(first, count));
+
+            if (count > leaf_size && level < bits)
+            {
+                for (int k = first, end = first + count; k < end; )
+                {
+                    const int o = octant(keys[k].key, level);
+                    int e = k + 1;
+                    while (e < end && octant(keys[e].key, level) == o) ++e;
+                    subtree(out, k, e - k, level + 1);
+                    k = e;
+                }
+            }
+            out[self].next = int(out.size());
+        }
+
+        // the cells above top_level, with the chunks' subtrees copied in
+        void joinTop(int first, int count, int level, int &chunk)
+        {
+            if (level == top_level)
+            {
+                const Chunk &c = chunks[chunk++];
+                const int start = int(cells.size());
+                for (std::size_t i = 0; i < c.cells.size(); ++i)
+                {
+                    Cell cell = c.cells[i];
+                    cell.next += start;
+                    cells.push_back(cell);
+                }
+                return;
+            }
+
+            const int self = int(cells.size());
+            cells.push_back(newCell(first, count));
+
+            if (count > leaf_size)
+            {
+                for (int k = first, end = first + count; k < end; )
+                {
+                    const int o = octant(keys[k].key, level);
+                    int e = k + 1;
+                    while (e < end && octant(keys[e].key, level) == o) ++e;
+                    joinTop(k, e - k, level + 1, chunk);
+                    k = e;
+                }
+            }
+            else
+            {
+                // a leaf above top_level: skip the chunks it holds
+                while (chunk < int(chunks.size()) && chunks[chunk].first < first + count) ++chunk;
+            }
+            cells[self].next = int(cells.size());
+        }
+
+        void refit(const Particles &p)
+        {
+            gather(p);
+            moments();
+        }
+
+        /* Centre of mass and opening distance of every cell, each from
+           its own particles (so the cells are independent, and a cell of
+           m particles costs m, O(n log n) for the lot)
+        */
+        void moments()
+        {
+            #pragma omp parallel for schedule(dynamic, 64)
+            for (int i = 0; i < int(cells.size()); ++i) moment(i);
+        }
+
+        void moment(int i)
+        {
+            Cell &c = cells[i];
+            double mass = 0, mx = 0, my = 0, mz = 0;
+            double lo[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL }, hi[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+
+            // the box of the particles themselves, so it is right after a refit too
+            for (int k = c.first; k < c.first + c.count; ++k)
+            {
+                mass += m[k];
+                mx += m[k] * x[k]; my += m[k] * y[k]; mz += m[k] * z[k];
+                lo[0] = std::min(lo[0], x[k]); hi[0] = std::max(hi[0], x[k]);
+                lo[1] = std::min(lo[1], y[k]); hi[1] = std::max(hi[1], y[k]);
+                lo[2] = std::min(lo[2], z[k]); hi[2] = std::max(hi[2], z[k]);
+            }
+
+            c.m = mass;
+            c.x = (mass > 0) ? mx / mass : 0.5 * (lo[0] + hi[0]);
+            c.y = (mass > 0) ? my / mass : 0.5 * (lo[1] + hi[1]);
+            c.z = (mass > 0) ? mz / mass : 0.5 * (lo[2] + hi[2]);
+
+            const double size = std::max(std::max(hi[0] - lo[0], hi[1] - lo[1]), hi[2] - lo[2]);
+            const double dx = c.x - 0.5 * (lo[0] + hi[0]), dy = c.y - 0.5 * (lo[1] + hi[1]), dz = c.z - 0.5 * (lo[2] + hi[2]);
+            c.open = (theta > 0) ? size / theta + std::sqrt(dx * dx + dy * dy + dz * dz) : HUGE_VAL;
+        }
+
+        /* The walk is done once for each leaf cell, for all of its particles
+           together: a cell is used whole if it is far enough from every
+           point of the leaf's bounding sphere, and the cells used whole
+           and the particles of the leaves opened are collected into one
+           list of point masses, which every particle of the leaf then sums
+           in a loop that vectorises.
+        */
+        double walk(Particles &p)
+        {
+            const Cell *tree = &cells[0];
+            const int n_cells = int(cells.size());
+            double potential = 0.0;
+
+            #pragma omp parallel reduction(+:potential)
+            {
+                std::vector<double> lx, ly, lz, lm;     // the interaction list
+
+                #pragma omp for schedule(dynamic, 4)
+                for (int g = 0; g < int(leaves.size()); ++g)
+                {
+                    const Cell &leaf = tree[leaves[g]];
+                    const int first = leaf.first, end = leaf.first + leaf.count;
+
+                    // bounding sphere of the leaf
+                    double lo[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL }, hi[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+                    for (int k = first; k < end; ++k)
+                    {
+                        lo[0] = std::min(lo[0], x[k]); hi[0] = std::max(hi[0], x[k]);
+                        lo[1] = std::min(lo[1], y[k]); hi[1] = std::max(hi[1], y[k]);
+                        lo[2] = std::min(lo[2], z[k]); hi[2] = std::max(hi[2], z[k]);
+                    }
+                    const double gx = 0.5 * (lo[0] + hi[0]), gy = 0.5 * (lo[1] + hi[1]), gz = 0.5 * (lo[2] + hi[2]);
+                    const double radius = 0.5 * std::sqrt((hi[0] - lo[0]) * (hi[0] - lo[0]) + (hi[1] - lo[1]) * (hi[1] - lo[1])
+                                                          + (hi[2] - lo[2]) * (hi[2] - lo[2]));
+
+                    lx.clear(); ly.clear(); lz.clear(); lm.clear();
+                    for (int i = 0; i < n_cells; )
+                    {
+                        const Cell &c = tree[i];
+                        const double dx = c.x - gx, dy = c.y - gy, dz = c.z - gz;
+                        const double reach = c.open + radius;
+
+                        if (dx * dx + dy * dy + dz * dz > reach * reach)
+                        {
+                            lx.push_back(c.x); ly.push_back(c.y); lz.push_back(c.z); lm.push_back(c.m);
+                            i = c.next;
+                        }
+                        else if (c.next == i + 1)
+                        {
+                            lx.insert(lx.end(), &x[c.first], &x[c.first] + c.count);
+                            ly.insert(ly.end(), &y[c.first], &y[c.first] + c.count);
+                            lz.insert(lz.end(), &z[c.first], &z[c.first] + c.count);
+                            lm.insert(lm.end(), &m[c.first], &m[c.first] + c.count);
+                            i = c.next;
+                        }
+                        else ++i;
+                    }
+
+                    const int n_list = int(lx.size());
+                    const double *qx = &lx[0], *qy = &ly[0], *qz = &lz[0], *qm = &lm[0];
+                    for (int k = first; k < end; ++k)
+                    {
+                        const double xi = x[k], yi = y[k], zi = z[k];
+                        double sx = 0.0, sy = 0.0, sz = 0.0, sp = 0.0;
+
+                        // (leaving out the particle itself, as in DirectSum)
+                        #pragma omp simd reduction(+:sx,sy,sz,sp)
+                        for (int j = 0; j < n_list; ++j)
+                        {
+                            const double ex = qx[j] - xi, ey = qy[j] - yi, ez = qz[j] - zi;
+                            const double r2 = ex * ex + ey * ey + ez * ez;
+                            const double s = inverseSqrt(r2 + eps2);
+                            const double inv = (r2 > 0.0) ? s : 0.0;
+                            const double mr = qm[j] * inv, mr3 = mr * inv * inv;
+                            sx += ex * mr3; sy += ey * mr3; sz += ez * mr3; sp += mr;
+                        }
+
+                        const int pi = order[k];
+                        p.ax[pi] = G * sx; p.ay[pi] = G * sy; p.az[pi] = G * sz;
+                        potential -= 0.5 * G * m[k] * sp;
+                    }
+                }
+            }
+
+            return potential;
+        }
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef DIRECT_H
+#define DIRECT_H
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "particles.h"
+
+/* 1 / sqrt(x) to double precision, without a sqrt or a division: the
+   first guess comes from halving the exponent in the bits of x (the
+   "fast inverse square root" trick, with the constant for doubles),
+   good to a few percent, and four Newton steps (each doubling the
+   number of correct digits) take it to rounding error. The double sqrt
+   and division didn't get any faster with wider vectors, and were most
+   of the cost of the force loop; this is all multiplies, and over three
+   times as fast. x must be positive, or 0 (giving a large finite y).
+*/
+inline double inverseSqrt(double x)
+{
+    std::uint64_t i;
+    std::memcpy(&i, &x, sizeof(x));
+    i = 0x5fe6eb50c7b537a9 - (i >> 1);
+
+    double y;
+    std::memcpy(&y, &i, sizeof(y));
+    const double half = 0.5 * x;
+    for (int k = 0; k < 4; ++k) y = y * (1.5 - half * y * y);
+    return y;
+}
+
+
+/* Direct summation of the gravitational forces: every particle feels
+   every other, O(n^2), exact up to the softening eps (the potential is
+   -G m1 m2 / sqrt(r^2 + eps^2), which keeps close encounters finite).
+
+   Each thread takes a share of the particles i and sums over all j in
+   a loop that vectorises (the SIMD lanes take consecutive j). The j
+   loop runs over tiles of `tile` particles at a time, and every i
+   goes through a tile before the next one is started, so the j data
+   (x, y, z, m: 32 bytes a particle) comes from cache however many
+   particles there are. The potential energy is summed in the same
+   loop. Using Newton's third law would halve the arithmetic, but the
+   scattered updates of the j forces would not vectorise or thread.
+*/
+class DirectSum
+{
+    public:
+        DirectSum(double G, double eps, int tile = 1024) : G(G), eps2(eps * eps), tile(tile) {}
+
+        // fill in the accelerations, and return the potential energy
+        double accelerations(Particles &p) const
+        {
+            const int n = p.size();
+            const double *x = &p.x[0], *y = &p.y[0], *z = &p.z[0], *m = &p.m[0];
+            double *ax = &p.ax[0], *ay = &p.ay[0], *az = &p.az[0];
+            double potential = 0.0;
+
+            #pragma omp parallel reduction(+:potential)
+            {
+                for (int jt = 0; jt < n; jt += tile)
+                {
+                    const int j_end = std::min(n, jt + tile);
+
+                    // the same i for each thread on every tile, so no barrier is needed
+                    #pragma omp for schedule(static) nowait
+                    for (int i = 0; i < n; ++i)
+                    {
+                        const double xi = x[i], yi = y[i], zi = z[i];
+                        double sx = 0.0, sy = 0.0, sz = 0.0, sp = 0.0;
+
+                        #pragma omp simd reduction(+:sx,sy,sz,sp)
+                        for (int j = jt; j < j_end; ++j)
+                        {
+                            const double dx = x[j] - xi, dy = y[j] - yi, dz = z[j] - zi;
+                            const double r2 = dx * dx + dy * dy + dz * dz;
+
+                            // (leaving out i = j, without a branch so that it vectorises)
+                            const double s = inverseSqrt(r2 + eps2);
+                            const double inv = (r2 > 0.0) ? s : 0.0;
+                            const double mr = m[j] * inv, mr3 = mr * inv * inv;
+                            sx += dx * mr3;
+                            sy += dy * mr3;
+                            sz += dz * mr3;
+                            sp += mr;
+                        }
+
+                        if (jt == 0) { ax[i] = G * sx; ay[i] = G * sy; az[i] = G * sz; }
+                        else { ax[i] += G * sx; ay[i] += G * sy; az[i] += G * sz; }
+
+                        // each pair is counted from both ends
+                        potential -= 0.5 * G * m[i] * sp;
+                    }
+                }
+            }
+
+            return potential;
+        }
+
+        // pairs of particles per force calculation
+        static double interactions(int n) { return double(n) * (n - 1); }
+
+    private:
+        double G, eps2;
+        int tile;
+};
+
+#endif
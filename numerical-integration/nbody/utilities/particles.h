@@ -0,0 +1,114 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <vector>
+#include <cmath>
+
+/* A set of n point masses, stored as structure of arrays: one array
+   per coordinate, so the force loops read each quantity contiguously
+   and vectorise. The accelerations are kept with the particles, as
+   they are needed again at the start of the next step.
+*/
+struct Particles
+{
+    explicit Particles(int n)
+        : x(n), y(n), z(n), vx(n), vy(n), vz(n), ax(n), ay(n), az(n), m(n) {}
+
+    int size() const { return int(m.size()); }
+
+    std::vector<double> x, y, z;
+    std::vector<double> vx, vy, vz;
+    std::vector<double> ax, ay, az;
+    std::vector<double> m;
+};
+
+
+// conserved quantities, to check on the integration
+struct Diagnostics
+{
+    double kinetic, potential;
+    double px, py, pz;          // total momentum
+
+    double energy() const { return kinetic + potential; }
+    double momentum() const { return std::sqrt(px * px + py * py + pz * pz); }
+};
+
+
+/* Newtonian gravity for a SymplecticStepper (see symplectic.h), with
+   the accelerations from a force engine (e.g. DirectSum), called as
+
+       double potential = engine.accelerations(particles)
+
+   to fill in ax, ay, az and return the potential energy, which it gets
+   in the same pass. The kinetic energy and momentum are likewise
+   summed while kicking, so after each step (which ends with a kick)
+   diagnostics() is up to date at no extra cost.
+*/
+template <class Forces>
+class NBody
+{
+    public:
+        explicit NBody(Forces &engine) : engine(engine)
+        {
+            last.kinetic = last.potential = last.px = last.py = last.pz = 0.0;
+        }
+
+        void forces(Particles &p) { last.potential = engine.accelerations(p); }
+
+        void kick(Particles &p, double dt)
+        {
+            const int n = p.size();
+            double *vx = &p.vx[0], *vy = &p.vy[0], *vz = &p.vz[0];
+            const double *ax = &p.ax[0], *ay = &p.ay[0], *az = &p.az[0], *m = &p.m[0];
+            double kinetic = 0.0, px = 0.0, py = 0.0, pz = 0.0;
+
+            #pragma omp parallel for simd reduction(+:kinetic,px,py,pz)
+            for (int i = 0; i < n; ++i)
+            {
+                vx[i] += dt * ax[i];
+                vy[i] += dt * ay[i];
+                vz[i] += dt * az[i];
+                kinetic += 0.5 * m[i] * (vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+                px += m[i] * vx[i];
+                py += m[i] * vy[i];
+                pz += m[i] * vz[i];
+            }
+
+            last.kinetic = kinetic;
+            last.px = px;
+            last.py = py;
+            last.pz = pz;
+        }
+
+        void drift(Particles &p, double dt)
+        {
+            const int n = p.size();
+            double *x = &p.x[0], *y = &p.y[0], *z = &p.z[0];
+            const double *vx = &p.vx[0], *vy = &p.vy[0], *vz = &p.vz[0];
+
+            #pragma omp parallel for simd
+            for (int i = 0; i < n; ++i)
+            {
+                x[i] += dt * vx[i];
+                y[i] += dt * vy[i];
+                z[i] += dt * vz[i];
+            }
+        }
+
+        // energies and momentum as of the last kick
+        const Diagnostics &diagnostics() const { return last; }
+
+        // work them out for the particles as they are (e.g. at the start)
+        const Diagnostics &measure(Particles &p)
+        {
+            forces(p);
+            kick(p, 0.0);
+            return last;
+        }
+
+    private:
+        Forces &engine;
+        Diagnostics last;
+};
+
+#endif
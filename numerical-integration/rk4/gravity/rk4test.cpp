@@ -1,124 +1,124 @@
 /* 
-   Simple program to use an RK4 integrator
+   Simple program to use an adaptive Runge-Kutta integrator
 
    The program describes the 1-dimensional motion of a particle
-   under earth's gravity. The RK4 solver can take coupled equations
+   under earth's gravity. The integrators can take coupled equations
    and we can use this to break down the 2nd order ODE into two 
    1st order equations:
 
    a = F / m   ->   v = dx / dt
                     a = dv / dt
 
+   The step size is chosen by the integrator to meet the tolerances,
+   the output is interpolated onto a regular grid of times, and the
+   moment the particle hits the ground is found as the root of the
+   position, rather than as the first step that overshoots it.
 */
 #include <iostream>
 #include <fstream>
 #include <cmath>
-#include <boost/numeric/ublas/vector.hpp>
+#include <array>
+
+#include "embedded.h"
 
-using namespace boost::numeric::ublas;
 using std::cout;
 using std::endl;
 
-double f(const double &t, const vector<double> &y, const int &i);
-void rk4(vector<double> &y, const double &t, const double &h);
+const int N = 2;    // this is the number of equations
 
-int main (int, char **) {
+// velocity and position
+typedef std::array<double, N> State;
 
+// which embedded pair to use
+enum Pair { DORMAND_PRINCE, CASH_KARP };
 
-    const int N = 2;    // this is the number of equations
-    double h = 0.01;    // stepsize
+// Simple function (note no time dependence)
+struct Gravity
+{
+    double F;       // gravitational force
+    double m;       // mass
 
-    // integration limits
-    double t_0 = 0.0, t_max = 10.0, t = t_0;
-    // initial values
-    vector<double> y_0(N);
-    y_0(0) = 10.0;           // initial velocity 0.0
-    y_0(1) = 10.0;          // initial position 10.0
+    void operator()(double, const State &y, State &dydt) const
+    {
+        dydt[0] = F / m;    // velocity is calculated from force
+        dydt[1] = y[0];     // position is calculated from velocity
+    }
+};
 
-    // start with initial value
-    vector<double> y(y_0);
+// the event: height above the ground
+double height(double, const State &y) { return y[1]; }
 
+template <class Method>
+void integrate(Gravity &f, const State &y_0, double t_0, double t_max, double h,
+               double atol, double rtol, double dt_out, std::ofstream &outputFile)
+{
+    EmbeddedStepper<Gravity, State, Method> stepper(f, atol, rtol);
+    stepper.reset(t_0, y_0, h);
 
-    // print header for output file
-    std::ofstream outputFile;
-    outputFile.open("data/output.dat");
-    outputFile << "# t\tvel\tpos" << endl;
+    double t_out = t_0 + dt_out;    // next time to write out
+    double t_hit = t_max;
+    State y = y_0, y_hit = y_0;
+    bool hit = false;
 
     // main integration loop
-    while (t < t_max)
+    while (!hit && stepper.time() < t_max)
     {
-        rk4(y, t, h);   // apply the integrator
-        t += h;         // increment timestep
+        if (!stepper.step(t_max)) break;
 
-        // write output to file
-        outputFile << t << "\t" << y(0) << "\t" << y(1) << endl;
+        // if the particle hits the ground, stop there!
+        hit = stepper.event(height, t_hit, y_hit);
 
-        // if the particle hits the ground, stop!
-        if (y(1) < 0) break;
+        // write output to file, at every dt_out up to the end of the step (or the impact)
+        for (; t_out < std::min(stepper.time(), t_hit); t_out += dt_out)
+        {
+            stepper.interpolate(t_out, y);
+            outputFile << t_out << "\t" << y[0] << "\t" << y[1] << endl;
+        }
     }
 
-    return 0;
+    if (hit)
+    {
+        outputFile << t_hit << "\t" << y_hit[0] << "\t" << y_hit[1] << endl;
+        cout << "hit the ground at t = " << t_hit << " with velocity " << y_hit[0] << endl;
+    }
+    cout << stepper.acceptedSteps() << " steps (" << stepper.rejectedSteps() << " rejected), "
+         << stepper.evaluations() << " evaluations" << endl;
 }
 
+int main (int, char **) {
 
-// Simple function (note no time dependence)
-double f(const double & /*t*/, const vector<double> &y, const int &i)
-{
-    // gravitational force
-    double F = -9.8;
-    double m = 1.0;
-
-    if (i == 0) return (F / m);     // velocity is calculated from force
-    if (i == 1) return y[0];        // position is calculated from velocity
-   
-    // this shouldn't happen!
-    return -1.0;
-}
 
-/* RK4 integrator
+    double h = 0.01;    // first stepsize (then chosen by the integrator)
 
-   Initially, y corresponds to y_n. At the end of 
-   the routine, y is updated (effectively becoming
-   y_(n+1).
-*/
-void rk4(vector<double> &y, const double &t, const double &h)
-{
-    int N = y.size();
+    double atol = 1e-8;     // absolute and relative tolerance
+    double rtol = 1e-8;     // of each step
 
-    double th = t + 0.5 * h;    // current time advanced by half a timestep
-    double tf = t + h;          // current time advanced by a timestep
+    double dt_out = 0.01;   // interval between output points
 
-    vector<double> k1(N), k2(N), k3(N), k4(N);
-    vector<double> temp1(N), temp2(N), temp3(N), temp4(N);
+    int pair = DORMAND_PRINCE;
 
-    // STEP 1
-    for (int i = 0; i < N; ++i)
-    {
-        k1(i) = h * f(t, y, i); 
-        temp1(i) = y(i) + 0.5 * k1(i);      // used in STEP 2
-    }
+    // integration limits
+    double t_0 = 0.0, t_max = 10.0;
+    // initial values
+    State y_0;
+    y_0[0] = 10.0;          // initial velocity 10.0
+    y_0[1] = 10.0;          // initial position 10.0
 
-    // STEP 2
-    for (int i = 0; i < N; ++i)
-    {
-        k2(i) = h * f(th, temp1, i); 
-        temp2(i) = y(i) + 0.5 * k2(i);      // used in STEP 3
-    }
+    Gravity f = { -9.8, 1.0 };
 
-    // STEP 3
-    for (int i = 0; i < N; ++i)
-    {
-        k3(i) = h * f(th, temp2, i);
-        temp3(i) = y(i) + k3(i);            // used in STEP 4
-    }
 
-    // STEP 4
-    for (int i = 0; i < N; ++i)
-        k4(i) = h * f(tf, temp3, i); 
+    // print header for output file
+    std::ofstream outputFile;
+    outputFile.open("data/output.dat");
+    outputFile << "# t\tvel\tpos" << endl;
 
+    if (pair == DORMAND_PRINCE) integrate<DormandPrince>(f, y_0, t_0, t_max, h, atol, rtol, dt_out, outputFile);
+    else integrate<CashKarp>(f, y_0, t_0, t_max, h, atol, rtol, dt_out, outputFile);
 
-    // then sum the contributions
-    for (int i = 0; i < N; ++i)
-        y(i) = y(i) + (k1(i) + k2(i) + k3(i) + k4(i)) / 6.0;
+    // exact answer, for comparison
+    double a = f.F / f.m;
+    double t_exact = (-y_0[0] - std::sqrt(y_0[0] * y_0[0] - 2 * a * y_0[1])) / a;
+    cout << "exact:               t = " << t_exact << " with velocity " << y_0[0] + a * t_exact << endl;
 
+    return 0;
 }
@@ -0,0 +1,5 @@
+set title "Allen-Cahn equation: phi at the start and the end"
+set xlabel "x"
+set ylabel "phi"
+plot "output.dat" using 1:2 with lines title "t = 0", \
+     "output.dat" using 1:3 with lines title "t = t_max"
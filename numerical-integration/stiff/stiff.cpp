@@ -0,0 +1,194 @@
+/*
+   Stiff integration of a reaction-diffusion equation
+
+   The Allen-Cahn equation
+
+       phi_t = D phi_xx + a (2 phi - 4 phi^3)
+
+   on [0, 1] with no flux at the ends: the reaction term (the rk4 basic
+   test's f(phi)) drives phi to +-1/sqrt(2), and diffusion smooths it
+   into fronts between the two, which then slowly move and merge. On a
+   grid of N points the diffusion has modes decaying at up to 4 D / dx^2,
+   far faster than anything the solution does, so explicit RK4 needs
+   steps of order dx^2 / D. The stiff integrators of
+   ../integrators/stiff.h only need steps for the fronts.
+*/
+#include <iostream>
+#include <fstream>
+#include <array>
+#include <cmath>
+#include <omp.h>
+
+#include "rk4.h"
+#include "stiff.h"
+
+using std::cout;
+using std::endl;
+
+const int N = 512;                  // grid points
+typedef std::array<double, N> State;
+
+// which integrator to use (RK4 for comparison)
+enum Method { ROSENBROCK, BDF_FIXED, MIDPOINT, RK4 };
+
+// how to solve the linear systems
+enum Solver { DENSE, BANDED, TRIDIAGONAL };
+
+// how to work out the Jacobian
+enum Derivatives { FINITE_DIFFERENCE, DUAL };
+
+// phi_t = D phi_xx + a (2 phi - 4 phi^3), on T = double or Dual
+struct AllenCahn
+{
+    double D, a, dx;
+
+    template <class T>
+    void operator()(double, const std::array<T, N> &phi, std::array<T, N> &dphi) const
+    {
+        const double k = D / (dx * dx);
+        for (int i = 0; i < N; ++i)
+        {
+            // no flux: reflect at the ends
+            const T &left = phi[(i == 0) ? 1 : i - 1], &right = phi[(i == N - 1) ? N - 2 : i + 1];
+            dphi[i] = k * (left - 2 * phi[i] + right) + a * (2 * phi[i] - 4 * phi[i] * phi[i] * phi[i]);
+        }
+    }
+};
+
+template <class Stepper>
+void report(const Stepper &stepper, long steps, double wall)
+{
+    cout << steps << " steps, " << stepper.evaluations() << " calls to the system, "
+         << stepper.jacobians() << " Jacobians, " << stepper.factorisations() << " LU factorisations in "
+         << wall << " s" << endl;
+}
+
+template <class Linear, class Jacobian>
+void integrate(AllenCahn &system, State &phi, int method, int order, double h, double t_max,
+               double atol, double rtol, int max_age)
+{
+    double wall = omp_get_wtime();
+
+    if (method == ROSENBROCK)
+    {
+        RosenbrockW<AllenCahn, N, Linear, Jacobian> stepper(system, atol, rtol, max_age);
+        stepper.reset(0.0, phi, h);
+        while (stepper.time() < t_max)
+            if (!stepper.step(t_max))
+            {
+                cout << "step size too small at t = " << stepper.time() << endl;
+                break;
+            }
+        phi = stepper.state();
+
+        report(stepper, stepper.acceptedSteps(), omp_get_wtime() - wall);
+        cout << "(" << stepper.rejectedSteps() << " rejected, last step " << stepper.stepSize() << ")" << endl;
+        return;
+    }
+
+    const long steps = long(t_max / h + 0.5);
+    long step = 0;
+
+    if (method == BDF_FIXED)
+    {
+        BDF<AllenCahn, N, Linear, Jacobian> stepper(system, order, atol, rtol, max_age);
+        for (; step < steps; ++step)
+            if (!stepper.step(phi, step * h, h)) break;
+        report(stepper, step, omp_get_wtime() - wall);
+    }
+    else
+    {
+        ImplicitMidpoint<AllenCahn, N, Linear, Jacobian> stepper(system, atol, rtol, max_age);
+        for (; step < steps; ++step)
+            if (!stepper.step(phi, step * h, h)) break;
+        report(stepper, step, omp_get_wtime() - wall);
+    }
+
+    if (step < steps) cout << "Newton iterations failed at t = " << step * h << endl;
+}
+
+// pick the linear solver and Jacobian at compile time
+template <class Linear>
+void integrate(AllenCahn &system, State &phi, int method, int derivatives, int order, double h,
+               double t_max, double atol, double rtol, int max_age)
+{
+    if (derivatives == DUAL)
+        integrate<Linear, AutoDiff>(system, phi, method, order, h, t_max, atol, rtol, max_age);
+    else
+        integrate<Linear, FiniteDifference>(system, phi, method, order, h, t_max, atol, rtol, max_age);
+}
+
+// fixed step RK4, at a step it is stable with
+void explicitRK4(AllenCahn &system, State &phi, double h, double t_max)
+{
+    RK4Stepper<AllenCahn, State> stepper(system);
+    const long steps = long(std::ceil(t_max / h));
+    h = t_max / steps;
+
+    double wall = omp_get_wtime();
+    for (long step = 0; step < steps; ++step) stepper.step(phi, step * h, h);
+    wall = omp_get_wtime() - wall;
+
+    cout << steps << " steps, " << stepper.evaluations() << " calls to the system in " << wall << " s" << endl;
+}
+
+int main (int, char **)
+{
+
+    double D = 0.01;                // diffusion constant
+    double a = 10.0;                // strength of the reaction term
+    double t_max = 10.0;            // time to run to
+
+    int method = ROSENBROCK;
+    int solver = TRIDIAGONAL;       // DENSE is O(N^3) per factorisation, the others O(N)
+    int derivatives = DUAL;         // exact Jacobian, or FINITE_DIFFERENCE
+
+    double h = 1e-3;                // ROSENBROCK: first step; BDF_FIXED, MIDPOINT: the step
+    int order = 2;                  // BDF_FIXED: 1 to 5
+    double atol = 1e-6, rtol = 1e-6;// ROSENBROCK: error per step; the others: Newton tolerance
+    int max_age = 20;               // steps to keep a Jacobian for
+
+    bool compare = true;            // also run RK4 and compare
+
+
+    AllenCahn system = { D, a, 1.0 / N };
+
+    State phi_0, phi;
+    for (int i = 0; i < N; ++i)
+    {
+        const double x = (i + 0.5) * system.dx;
+        phi_0[i] = 0.1 * std::cos(6 * M_PI * x) + 0.05 * std::cos(14 * M_PI * x + 1);
+    }
+    phi = phi_0;
+
+    // the fastest decaying mode, which limits an explicit step
+    const double h_explicit = 0.5 * system.dx * system.dx / D;
+    cout << N << " points, stiffness 4 D / dx^2 = " << 4 * D / (system.dx * system.dx) << endl;
+
+    if (method == RK4) explicitRK4(system, phi, h_explicit, t_max);
+    else if (solver == DENSE)
+        integrate<DenseLU<N> >(system, phi, method, derivatives, order, h, t_max, atol, rtol, max_age);
+    else if (solver == BANDED)
+        integrate<BandedLU<N, 1, 1> >(system, phi, method, derivatives, order, h, t_max, atol, rtol, max_age);
+    else
+        integrate<Tridiagonal<N> >(system, phi, method, derivatives, order, h, t_max, atol, rtol, max_age);
+
+    if (compare && method != RK4)
+    {
+        State reference(phi_0);
+        cout << "RK4: ";
+        explicitRK4(system, reference, h_explicit, t_max);
+
+        double difference = 0.0;
+        for (int i = 0; i < N; ++i) difference = std::max(difference, std::fabs(phi[i] - reference[i]));
+        cout << "largest difference from RK4 " << difference << endl;
+    }
+
+
+    std::ofstream outputFile("data/output.dat");
+    outputFile << "# x\tphi_0\tphi" << endl;
+    for (int i = 0; i < N; ++i)
+        outputFile << (i + 0.5) * system.dx << "\t" << phi_0[i] << "\t" << phi[i] << endl;
+
+    return 0;
+}